@@ -20,6 +20,14 @@ layout ( binding = 0, std140 ) uniform CameraTransforms
 } Cam;
 
 layout ( binding = 1 ) uniform sampler2D HeightMap;
+// Interactive wake heights (meters) from WakeSim, stored toroidally so uv = worldXY / extent
+layout ( binding = 2 ) uniform sampler2D WakeMap;
+uniform vec4 WakeParams = vec4(0.0, 0.0, 1.0, 0.0); // xy = window min corner (world), z = extent (m), w = scale (0 = off)
+
+// Infinite ocean (OceanClipmap). When OceanGridN > 0, VertexPosition is (ix, iy, level) in grid
+// units of that level and VertexTexCoord.x is the vertex kind (0 grid, 1 trim column, 2 trim row).
+uniform float OceanGridN = 0.0;
+uniform vec4 OceanLevels[8]; // xy = snapped min corner (world), z = cell size, w = trim bits
 uniform float DisplacementScale = 20.0;
 uniform float Time = 0.0;
 uniform float SpeedMultiplier = 1.0;
@@ -34,13 +42,22 @@ out flat int ShadowMapShadingState;
 out float Height;
 out vec2 WorldPos2D;
 
+// Amplitude factor for a wave on a mesh with the given cell size: 1 for wavelengths of 4 cells
+// or more, fading to 0 at the Nyquist limit of 2 cells so coarse clipmap levels do not alias
+// short waves into false swells. cell = 0 (fixed grid) disables it.
+float bandLimit(float wavelength, float cell) {
+    if (cell <= 0.0)
+        return 1.0;
+    return smoothstep(2.0 * cell, 4.0 * cell, wavelength);
+}
+
 // Gerstner wave function
-vec3 gerstnerWave(vec2 pos, vec2 direction, float wavelength, float steepness, float speed) {
+vec3 gerstnerWave(vec2 pos, vec2 direction, float wavelength, float steepness, float speed, float cell) {
     float k = 2.0 * 3.14159 / wavelength;  // Wave number
     float c = sqrt(9.8 / k);  // Wave speed from gravity
     vec2 d = normalize(direction);
     float f = k * (dot(d, pos) - c * speed * Time);
-    float a = steepness / k;
+    float a = steepness / k * bandLimit(wavelength, cell);
     
     return vec3(
         d.x * (a * cos(f)),  // X displacement
@@ -52,37 +69,92 @@ vec3 gerstnerWave(vec2 pos, vec2 direction, float wavelength, float steepness, f
 
 
 
+vec3 gerstnerSum(vec2 pos, float cell) {
+    return gerstnerWave(pos, vec2(1.0, 0.3), 10.0 / FrequencyMultiplier, 0.5, SpeedMultiplier, cell)
+         + gerstnerWave(pos, vec2(0.7, -0.8), 15.0 / FrequencyMultiplier, 0.3, SpeedMultiplier * 0.8, cell)
+         + gerstnerWave(pos, vec2(-0.5, 1.0), 8.0 / FrequencyMultiplier, 0.4, SpeedMultiplier * 1.2, cell);
+}
+
+// Clipmap vertex (grid x, grid y, level, kind) from the float attributes
+ivec4 clipmapVertex() {
+    return ivec4(ivec2(VertexPosition.xy + 0.5), int(VertexPosition.z + 0.5), int(VertexTexCoord.x + 0.5));
+}
+
+// World XY of a clipmap vertex; same math as OceanClipmap::worldPosition(). Odd vertices on a
+// level's outer edge get a stitch direction so they can follow the coarser level's straight edge.
+// bandCell is the cell size used for band limiting: the level's own in its inner part, ramping to
+// the next coarser level's over the outer eighth so both levels agree on the shared edge.
+vec2 clipmapPosition(out vec2 stitch, out float bandCell) {
+    int N = int(OceanGridN);
+    ivec4 v = clipmapVertex();
+    vec4 lvl = OceanLevels[v.z];
+    ivec2 g = v.xy;
+    int kind = v.w;
+    int trim = int(lvl.w + 0.5);
+    if (kind == 1) { g.x += (trim & 1) != 0 ? N / 2 : 0; g.y += (trim & 2) != 0 ? 0 : 1; }
+    else if (kind == 2) { g.y += (trim & 2) != 0 ? N / 2 : 0; }
+    int edgeDist = min(min(g.x, g.y), min(N - g.x, N - g.y));
+    bandCell = lvl.z * (2.0 - clamp(float(edgeDist) / float(max(N / 8, 1)), 0.0, 1.0));
+    stitch = vec2(0.0);
+    if ((g.y == 0 || g.y == N) && (g.x & 1) == 1) stitch = vec2(lvl.z, 0.0);
+    if ((g.x == 0 || g.x == N) && (g.y & 1) == 1) stitch = vec2(0.0, lvl.z);
+    return lvl.xy + vec2(g) * lvl.z;
+}
+
+// Wake height at a world position, faded out near the edges of the simulated window
+float wakeHeight(vec2 pos) {
+    if (WakeParams.w == 0.0)
+        return 0.0;
+    vec2 rel = (pos - WakeParams.xy) / WakeParams.z;
+    vec2 edge = min(rel, 1.0 - rel);
+    float fade = smoothstep(0.0, 0.05, min(edge.x, edge.y));
+    return texture(WakeMap, pos / WakeParams.z).r * WakeParams.w * fade;
+}
+
 void main()
 {
     Color = VertexColor;
     TexCoord = ( TexMat0 * vec4( VertexTexCoord, 0, 1 ) ).st;
+
+    vec3 basePosition = VertexPosition;
+    vec2 stitch = vec2(0.0);
+    float bandCell = 0.0;
+    if (OceanGridN > 0.0) {
+        basePosition = vec3(clipmapPosition(stitch, bandCell), 0.0);
+        TexCoord = basePosition.xy / 400.0;
+    }
     
     // Get world position FIRST
-    vec4 worldPos = ModelMat * vec4(VertexPosition, 1.0);
+    vec4 worldPos = ModelMat * vec4(basePosition, 1.0);
     vec2 worldPos2D = worldPos.xy;
     WorldPos2D = worldPos2D;
     
         // Sample cloud texture with animated scrolling - EXTREME VARIATION
     vec2 uv = worldPos2D * (0.1 * FrequencyMultiplier) + vec2(Time * 0.005 * SpeedMultiplier, Time * 0.003 * SpeedMultiplier);
     // Calculate Gerstner waves (3 different directions)
-    vec3 wave1 = gerstnerWave(worldPos2D, vec2(1.0, 0.3), 10.0 / FrequencyMultiplier, 0.5, SpeedMultiplier);
-    vec3 wave2 = gerstnerWave(worldPos2D, vec2(0.7, -0.8), 15.0 / FrequencyMultiplier, 0.3, SpeedMultiplier * 0.8);
-    vec3 wave3 = gerstnerWave(worldPos2D, vec2(-0.5, 1.0), 8.0 / FrequencyMultiplier, 0.4, SpeedMultiplier * 1.2);
-
-    // Sum all waves
-    vec3 totalDisplacement = wave1 + wave2 + wave3;
+    // Sum all waves; stitched edge vertices take the average of their neighbors (no T-junction cracks)
+    vec3 totalDisplacement = gerstnerSum(worldPos2D, bandCell);
+    if (stitch != vec2(0.0))
+        totalDisplacement = 0.5 * (gerstnerSum(worldPos2D - stitch, bandCell) + gerstnerSum(worldPos2D + stitch, bandCell));
     float heightValue = totalDisplacement.z;  // Just the vertical component for now
         // Combine texture detail + rolling waves
         float finalHeight = heightValue;
 
+    // Wake from objects disturbing the water, added on top of the Gerstner waves; stitched the
+    // same way so it does not crack where a level meets the coarser one
+    float wake = wakeHeight(worldPos2D);
+    if (stitch != vec2(0.0))
+        wake = 0.5 * (wakeHeight(worldPos2D - stitch) + wakeHeight(worldPos2D + stitch));
+
     // Pass to fragment shader
-    Height = finalHeight;
+    Height = finalHeight + wake / max(DisplacementScale, 0.001);
         
     // Displace vertex in 3D (X, Y, AND Z!)
-    vec3 displacedPosition = VertexPosition;
+    vec3 displacedPosition = basePosition;
     displacedPosition.x += totalDisplacement.x * DisplacementScale;  // Horizontal displacement
     displacedPosition.y += totalDisplacement.y * DisplacementScale;  // Horizontal displacement
     displacedPosition.z += totalDisplacement.z * DisplacementScale;  // Vertical displacement
+    displacedPosition.z += wake;
 
     // Recalculate normals using texture
     // Calculate Gerstner wave normals analytically
@@ -97,6 +169,7 @@ void main()
         else if(i == 1) { dir = vec2(0.7, -0.8); wavelength = 15.0 / FrequencyMultiplier; steepness = 0.3; speed = SpeedMultiplier * 0.8; }
         else { dir = vec2(-0.5, 1.0); wavelength = 8.0 / FrequencyMultiplier; steepness = 0.4; speed = SpeedMultiplier * 1.2; }
         
+        steepness *= bandLimit(wavelength, bandCell);
         float k = 2.0 * 3.14159 / wavelength;
         float c = sqrt(9.8 / k);
         vec2 d = normalize(dir);
@@ -109,6 +182,13 @@ void main()
         normal.z -= steepness * sin(f);
     }
 
+    // Wake slope by central differences, one wake cell apart
+    if (WakeParams.w != 0.0) {
+        float cell = WakeParams.z / float(textureSize(WakeMap, 0).x);
+        normal.x -= (wakeHeight(worldPos2D + vec2(cell, 0.0)) - wakeHeight(worldPos2D - vec2(cell, 0.0))) / (2.0 * cell);
+        normal.y -= (wakeHeight(worldPos2D + vec2(0.0, cell)) - wakeHeight(worldPos2D - vec2(0.0, cell))) / (2.0 * cell);
+    }
+
     vec3 displacedNormal = normalize(normal);
     // Transform for rendering
     NormalES = ( Cam.View * ModelMat * vec4( displacedNormal, 0 ) ).xyz;
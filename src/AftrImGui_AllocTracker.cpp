@@ -0,0 +1,95 @@
+#include "AftrImGui_AllocTracker.h"
+#ifdef  AFTR_CONFIG_USE_IMGUI
+#include "AftrImGuiIncludes.h"
+
+void Aftr::AftrImGui_AllocTracker::draw()
+{
+    //ImGui requires End() whether or not Begin() returned true (false when collapsed)
+    if (ImGui::Begin("Heap Allocations"))
+    {
+        if (!AllocTracker::isEnabled())
+        {
+            ImGui::TextWrapped("Allocation tracking is not compiled in. Reconfigure with "
+                               "-DDISPLACEMENT_GRID_TRACK_ALLOCS=ON to hook global new/delete.");
+        }
+        else
+        {
+            this->draw_frame_stats();
+            this->draw_scope_table();
+            this->draw_site_table();
+            if (ImGui::Button("Reset"))
+                AllocTracker::reset();
+        }
+    }
+    ImGui::End();
+}
+
+void Aftr::AftrImGui_AllocTracker::draw_frame_stats()
+{
+    AllocTracker::Stats f = AllocTracker::lastFrame();
+    AllocTracker::Stats t = AllocTracker::total();
+    ImGui::Text("Last frame: %llu allocs, %llu bytes, %llu frees",
+        (unsigned long long)f.count, (unsigned long long)f.bytes, (unsigned long long)f.frees);
+    ImGui::Text("Total:      %llu allocs, %llu bytes, %llu frees",
+        (unsigned long long)t.count, (unsigned long long)t.bytes, (unsigned long long)t.frees);
+    ImGui::Text("Live: %zu bytes   Peak (frame): %zu bytes   Peak (all time): %zu bytes",
+        AllocTracker::liveBytes(), AllocTracker::peakBytesLastFrame(), AllocTracker::peakBytes());
+}
+
+void Aftr::AftrImGui_AllocTracker::draw_scope_table()
+{
+    size_t n = AllocTracker::getScopes(this->scopes.data(), this->scopes.size());
+    if (n == 0 || !ImGui::CollapsingHeader("Scopes", ImGuiTreeNodeFlags_DefaultOpen))
+        return;
+    if (ImGui::BeginTable("scopes", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("Allocs/frame");
+        ImGui::TableSetupColumn("Bytes/frame");
+        ImGui::TableSetupColumn("Allocs total");
+        ImGui::TableSetupColumn("Bytes total");
+        ImGui::TableSetupColumn("Peak live (frame)");
+        ImGui::TableSetupColumn("Peak live (all time)");
+        ImGui::TableHeadersRow();
+        for (size_t i = 0; i < n; ++i)
+        {
+            const auto& s = this->scopes[i];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(s.name);
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)s.lastFrame.count);
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)s.lastFrame.bytes);
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)s.total.count);
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)s.total.bytes);
+            ImGui::TableNextColumn(); ImGui::Text("%zu", s.peakBytesLastFrame);
+            ImGui::TableNextColumn(); ImGui::Text("%zu", s.peakBytes);
+        }
+        ImGui::EndTable();
+    }
+}
+
+void Aftr::AftrImGui_AllocTracker::draw_site_table()
+{
+    if (!ImGui::CollapsingHeader("Top allocation sites", ImGuiTreeNodeFlags_DefaultOpen))
+        return;
+    ImGui::SliderInt("Sites shown", &this->topN, 1, int(this->sites.size()));
+    size_t n = AllocTracker::getTopSites(this->sites.data(), size_t(this->topN));
+    if (ImGui::BeginTable("sites", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Return address");
+        ImGui::TableSetupColumn("First scope");
+        ImGui::TableSetupColumn("Allocs total");
+        ImGui::TableSetupColumn("Bytes total");
+        ImGui::TableHeadersRow();
+        for (size_t i = 0; i < n; ++i)
+        {
+            const auto& s = this->sites[i];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::Text("%p", s.site);
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(s.scope != nullptr ? s.scope : "-");
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)s.count);
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)s.bytes);
+        }
+        ImGui::EndTable();
+    }
+}
+#endif //  AFTR_CONFIG_USE_IMGUI
@@ -0,0 +1,27 @@
+#pragma once
+#include "AftrConfig.h"
+#ifdef  AFTR_CONFIG_USE_IMGUI
+#include "AllocTracker.h"
+#include <array>
+
+namespace Aftr
+{
+	class AftrImGui_AllocTracker
+	{
+	public:
+		//main draw method called from GLView; shows per-frame, per-scope, and per-site heap
+		//allocation counts gathered by AllocTracker
+		void draw();
+
+	private:
+		void draw_frame_stats();
+		void draw_scope_table();
+		void draw_site_table();
+
+		int topN = 16; //adjusted by gui slider in draw_site_table
+		//Scratch storage lives here so drawing the panel does not itself allocate every frame
+		std::array< AllocTracker::ScopeStats, AllocTracker::MAX_SCOPES > scopes;
+		std::array< AllocTracker::SiteStats, 64 > sites;
+	};
+}
+#endif //  AFTR_CONFIG_USE_IMGUI
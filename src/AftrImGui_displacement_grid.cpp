@@ -2,12 +2,14 @@
 #include "AftrImGuiIncludes.h"
 #include "GLSLShaderDisplacement.h"  // ADD THIS LINE
 #include "GLSLUniform.h" 
-#include <fmt/core.h>
+#include "AllocTracker.h"
+#include "Log.h"
 #include <chrono>
 #include <cmath>  // ADD THIS LINE for std::pow
 
 void Aftr::AftrImGui_displacement_grid::draw()
 {
+    AFTR_ALLOC_SCOPE("orbit_gui.draw");
     this->draw_orbit_controls();
     this->draw_wave_controls();  // ADD THIS LINE
 }
@@ -23,12 +25,15 @@ void Aftr::AftrImGui_displacement_grid::draw_orbit_controls()
                 this->pause_time = std::chrono::system_clock::now();
             else
                 this->start_time = (std::chrono::system_clock::now() - pause_time) + start_time;
-            fmt::print("Moon Orbiter Status: {:b}...\n", this->isPaused);
+            AFTR_LOG_INFO("Moon Orbiter Status: {:b}...\n", this->isPaused);
         }
-        if (ImGui::SliderFloat("Radius (m)", &this->radius_m, 1.0f, 100.0f))
-            fmt::print("Adjusted Moon Orbiter radius to {:f} meters... Good job...\n", this->radius_m);
-        if (ImGui::SliderInt("Orbit time (msec)", &this->orbitTime_msec, 50, 10000))
-            fmt::print("Adjusted Moon Orbiter time to {:d} milliseconds... Better job...\n", this->orbitTime_msec);
+        // Log once when a drag ends, so the final value is always reported
+        ImGui::SliderFloat("Radius (m)", &this->radius_m, 1.0f, 100.0f);
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            AFTR_LOG_INFO("Adjusted Moon Orbiter radius to {:f} meters... Good job...\n", this->radius_m);
+        ImGui::SliderInt("Orbit time (msec)", &this->orbitTime_msec, 50, 10000);
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            AFTR_LOG_INFO("Adjusted Moon Orbiter time to {:d} milliseconds... Better job...\n", this->orbitTime_msec);
         ImGui::End();
     }
 }
@@ -43,8 +48,9 @@ void Aftr::AftrImGui_displacement_grid::draw_wave_controls()
             float speed = std::pow(2.0f, this->speedPower);
             if (this->displacementShader != nullptr && this->displacementShader->speedMultiplier != nullptr)
                 this->displacementShader->speedMultiplier->setValues(&speed);
-            fmt::print("Speed multiplier set to {:f} (2^{:f})\n", speed, this->speedPower);
         }
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            AFTR_LOG_INFO("Speed multiplier set to {:f} (2^{:f})\n", std::pow(2.0f, this->speedPower), this->speedPower);
 
         // Frequency slider
         if (ImGui::SliderFloat("Frequency Power", &this->frequencyPower, -2.0f, 3.0f, "2^%.1f"))
@@ -52,8 +58,9 @@ void Aftr::AftrImGui_displacement_grid::draw_wave_controls()
             float freq = std::pow(2.0f, this->frequencyPower);
             if (this->displacementShader != nullptr && this->displacementShader->frequencyMultiplier != nullptr)
                 this->displacementShader->frequencyMultiplier->setValues(&freq);
-            fmt::print("Frequency multiplier set to {:f} (2^{:f})\n", freq, this->frequencyPower);
         }
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            AFTR_LOG_INFO("Frequency multiplier set to {:f} (2^{:f})\n", std::pow(2.0f, this->frequencyPower), this->frequencyPower);
 
         // ADD THIS - Height slider
         if (ImGui::SliderFloat("Height Power", &this->heightPower, -3.0f, 6.0f, "2^%.1f"))
@@ -61,8 +68,17 @@ void Aftr::AftrImGui_displacement_grid::draw_wave_controls()
             float height = std::pow(2.0f, this->heightPower);
             if (this->displacementShader != nullptr && this->displacementShader->displacementScale != nullptr)
                 this->displacementShader->displacementScale->setValues(&height);
-            fmt::print("Height multiplier set to {:f} (2^{:f})\n", height, this->heightPower);
         }
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            AFTR_LOG_INFO("Height multiplier set to {:f} (2^{:f})\n", std::pow(2.0f, this->heightPower), this->heightPower);
+
+        // Interactive wake around the aircraft and moon
+        ImGui::Checkbox("Wake Simulation", &this->wakeEnabled);
+        ImGui::SliderFloat("Wake Height", &this->wakeHeightScale, 0.0f, 20.0f);
+
+        // Camera-following clipmap out to the far clip plane instead of the fixed 400x400 grid
+        if (ImGui::Checkbox("Infinite Ocean", &this->infiniteOcean))
+            AFTR_LOG_INFO("Infinite ocean {}\n", this->infiniteOcean ? "on" : "off");
 
         ImGui::End();
     }
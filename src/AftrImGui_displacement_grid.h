@@ -20,6 +20,9 @@ namespace Aftr
 		//origin orientation and position. Each revolution takes the specified time.
 		Mat4 compute_pose(Mat4 const& origin_pose);
 		GLSLShaderDisplacement* displacementShader = nullptr;
+		bool wakeEnabled = true;       //adjusted by gui checkbox in draw_wave_controls, read by GLView
+		float wakeHeightScale = 4.0f;  //adjusted by gui slider in draw_wave_controls, read by GLView
+		bool infiniteOcean = false;    //adjusted by gui checkbox in draw_wave_controls, read by GLView
 
 	private:
 		//draws the gui widgets that let the user manipulate orbit parameters
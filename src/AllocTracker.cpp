@@ -0,0 +1,338 @@
+#include "AllocTracker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+   #include <intrin.h>
+   #define AFTR_ALLOC_RETURN_ADDRESS() _ReturnAddress()
+#else
+   #define AFTR_ALLOC_RETURN_ADDRESS() __builtin_return_address( 0 )
+#endif
+
+using namespace Aftr;
+
+#ifdef DISPLACEMENT_GRID_TRACK_ALLOCS
+
+namespace
+{
+   //Nothing in this namespace may allocate; it runs inside operator new.
+   struct AtomicStats
+   {
+      std::atomic< uint64_t > count{ 0 };
+      std::atomic< uint64_t > bytes{ 0 };
+      std::atomic< uint64_t > frees{ 0 };
+
+      void add( uint64_t nBytes )
+      {
+         count.fetch_add( 1, std::memory_order_relaxed );
+         bytes.fetch_add( nBytes, std::memory_order_relaxed );
+      }
+      AllocTracker::Stats load() const
+      {
+         return { count.load( std::memory_order_relaxed ), bytes.load( std::memory_order_relaxed ), frees.load( std::memory_order_relaxed ) };
+      }
+      AllocTracker::Stats exchangeZero()
+      {
+         return { count.exchange( 0 ), bytes.exchange( 0 ), frees.exchange( 0 ) };
+      }
+      void clear() { count = 0; bytes = 0; frees = 0; }
+   };
+
+   struct ScopeSlot
+   {
+      std::atomic< const char* > name{ nullptr };
+      AtomicStats frame;
+      AtomicStats total;
+      AllocTracker::Stats lastFrame; //written only by newFrame() on the main thread
+      std::atomic< int64_t > live{ 0 }; //signed: blocks allocated before a reset() may be freed after it
+      std::atomic< size_t > peak{ 0 };
+      std::atomic< size_t > framePeak{ 0 };
+      size_t lastFramePeak = 0;      //written only by newFrame() on the main thread
+   };
+
+   struct SiteSlot
+   {
+      std::atomic< const void* > site{ nullptr };
+      std::atomic< const char* > scope{ nullptr };
+      std::atomic< uint64_t > count{ 0 };
+      std::atomic< uint64_t > bytes{ 0 };
+   };
+
+   AtomicStats gFrame;
+   AtomicStats gTotal;
+   AllocTracker::Stats gLastFrame;
+   std::atomic< size_t > gLive{ 0 };
+   std::atomic< size_t > gPeak{ 0 };
+   std::atomic< size_t > gFramePeak{ 0 };
+   size_t gLastFramePeak = 0;
+   ScopeSlot gScopes[AllocTracker::MAX_SCOPES];
+   SiteSlot gSites[AllocTracker::MAX_SITES];
+
+   thread_local int tScopeSlot = -1;
+   thread_local uint64_t tCount = 0;
+   thread_local uint64_t tBytes = 0;
+   thread_local uint64_t tFrees = 0;
+
+   void raiseTo( std::atomic< size_t >& hwm, size_t v )
+   {
+      size_t cur = hwm.load( std::memory_order_relaxed );
+      while( v > cur && !hwm.compare_exchange_weak( cur, v, std::memory_order_relaxed ) )
+         ;
+   }
+
+   int findOrClaimScope( const char* name )
+   {
+      for( size_t i = 0; i < AllocTracker::MAX_SCOPES; ++i )
+      {
+         const char* cur = gScopes[i].name.load( std::memory_order_acquire );
+         if( cur == name )
+            return int( i );
+         if( cur == nullptr )
+         {
+            if( gScopes[i].name.compare_exchange_strong( cur, name ) || cur == name )
+               return int( i );
+         }
+      }
+      return -1; //table full, allocations in this scope are only counted globally
+   }
+
+   void recordSite( const void* site, size_t nBytes, const char* scope )
+   {
+      size_t h = ( reinterpret_cast< uintptr_t >( site ) >> 2 ) * 0x9E3779B97F4A7C15ull;
+      for( size_t probe = 0; probe < 16; ++probe )
+      {
+         SiteSlot& s = gSites[( h + probe ) & ( AllocTracker::MAX_SITES - 1 )];
+         const void* cur = s.site.load( std::memory_order_acquire );
+         if( cur == nullptr && s.site.compare_exchange_strong( cur, site ) )
+         {
+            s.scope.store( scope, std::memory_order_relaxed );
+            cur = site;
+         }
+         if( cur == site )
+         {
+            s.count.fetch_add( 1, std::memory_order_relaxed );
+            s.bytes.fetch_add( nBytes, std::memory_order_relaxed );
+            return;
+         }
+      }
+   }
+
+   void recordAlloc( size_t nBytes, const void* site, int scopeSlot )
+   {
+      gFrame.add( nBytes );
+      gTotal.add( nBytes );
+      ++tCount;
+      tBytes += nBytes;
+      const char* scopeName = nullptr;
+      if( scopeSlot >= 0 )
+      {
+         ScopeSlot& s = gScopes[scopeSlot];
+         s.frame.add( nBytes );
+         s.total.add( nBytes );
+         scopeName = s.name.load( std::memory_order_relaxed );
+         int64_t scopeLive = s.live.fetch_add( int64_t( nBytes ), std::memory_order_relaxed ) + int64_t( nBytes );
+         if( scopeLive > 0 )
+         {
+            raiseTo( s.peak, size_t( scopeLive ) );
+            raiseTo( s.framePeak, size_t( scopeLive ) );
+         }
+      }
+      recordSite( site, nBytes, scopeName );
+      size_t live = gLive.fetch_add( nBytes, std::memory_order_relaxed ) + nBytes;
+      raiseTo( gPeak, live );
+      raiseTo( gFramePeak, live );
+   }
+
+   //Every block carries a 16 byte header directly before the user pointer: the requested size,
+   //then the offset back to the pointer returned by malloc in the low bits and the scope slot + 1
+   //(0 = none) in the top bits, so a free on any thread is charged back to the allocating scope.
+   constexpr size_t HEADER = 16;
+   constexpr int SLOT_SHIFT = 48;
+   constexpr size_t OFFSET_MASK = ( size_t( 1 ) << SLOT_SHIFT ) - 1;
+
+   void* trackedAlloc( size_t size, size_t align, const void* site ) noexcept
+   {
+      if( align < HEADER )
+         align = HEADER;
+      char* raw = static_cast< char* >( std::malloc( size + HEADER + align ) );
+      if( raw == nullptr )
+         return nullptr;
+      uintptr_t u = ( reinterpret_cast< uintptr_t >( raw ) + HEADER + align - 1 ) & ~uintptr_t( align - 1 );
+      char* user = reinterpret_cast< char* >( u );
+      int slot = tScopeSlot;
+      reinterpret_cast< size_t* >( user )[-2] = size;
+      reinterpret_cast< size_t* >( user )[-1] = size_t( user - raw ) | ( size_t( slot + 1 ) << SLOT_SHIFT );
+      recordAlloc( size, site, slot );
+      return user;
+   }
+
+   void trackedFree( void* p ) noexcept
+   {
+      if( p == nullptr )
+         return;
+      char* user = static_cast< char* >( p );
+      size_t size = reinterpret_cast< size_t* >( user )[-2];
+      size_t word = reinterpret_cast< size_t* >( user )[-1];
+      size_t offset = word & OFFSET_MASK;
+      int slot = int( word >> SLOT_SHIFT ) - 1;
+      if( slot >= 0 )
+         gScopes[slot].live.fetch_sub( int64_t( size ), std::memory_order_relaxed );
+      gLive.fetch_sub( size, std::memory_order_relaxed );
+      gFrame.frees.fetch_add( 1, std::memory_order_relaxed );
+      gTotal.frees.fetch_add( 1, std::memory_order_relaxed );
+      ++tFrees;
+      std::free( user - offset );
+   }
+
+   void* trackedAllocOrThrow( size_t size, size_t align, const void* site )
+   {
+      void* p = trackedAlloc( size, align, site );
+      if( p == nullptr )
+         throw std::bad_alloc();
+      return p;
+   }
+}
+
+//Global replacements. The return address of operator new is the allocation site shown in the
+//Heap Allocations panel.
+void* operator new( size_t size ) { return trackedAllocOrThrow( size, 0, AFTR_ALLOC_RETURN_ADDRESS() ); }
+void* operator new[]( size_t size ) { return trackedAllocOrThrow( size, 0, AFTR_ALLOC_RETURN_ADDRESS() ); }
+void* operator new( size_t size, const std::nothrow_t& ) noexcept { return trackedAlloc( size, 0, AFTR_ALLOC_RETURN_ADDRESS() ); }
+void* operator new[]( size_t size, const std::nothrow_t& ) noexcept { return trackedAlloc( size, 0, AFTR_ALLOC_RETURN_ADDRESS() ); }
+void* operator new( size_t size, std::align_val_t al ) { return trackedAllocOrThrow( size, size_t( al ), AFTR_ALLOC_RETURN_ADDRESS() ); }
+void* operator new[]( size_t size, std::align_val_t al ) { return trackedAllocOrThrow( size, size_t( al ), AFTR_ALLOC_RETURN_ADDRESS() ); }
+void* operator new( size_t size, std::align_val_t al, const std::nothrow_t& ) noexcept { return trackedAlloc( size, size_t( al ), AFTR_ALLOC_RETURN_ADDRESS() ); }
+void* operator new[]( size_t size, std::align_val_t al, const std::nothrow_t& ) noexcept { return trackedAlloc( size, size_t( al ), AFTR_ALLOC_RETURN_ADDRESS() ); }
+void operator delete( void* p ) noexcept { trackedFree( p ); }
+void operator delete[]( void* p ) noexcept { trackedFree( p ); }
+void operator delete( void* p, size_t ) noexcept { trackedFree( p ); }
+void operator delete[]( void* p, size_t ) noexcept { trackedFree( p ); }
+void operator delete( void* p, const std::nothrow_t& ) noexcept { trackedFree( p ); }
+void operator delete[]( void* p, const std::nothrow_t& ) noexcept { trackedFree( p ); }
+void operator delete( void* p, std::align_val_t ) noexcept { trackedFree( p ); }
+void operator delete[]( void* p, std::align_val_t ) noexcept { trackedFree( p ); }
+void operator delete( void* p, size_t, std::align_val_t ) noexcept { trackedFree( p ); }
+void operator delete[]( void* p, size_t, std::align_val_t ) noexcept { trackedFree( p ); }
+void operator delete( void* p, std::align_val_t, const std::nothrow_t& ) noexcept { trackedFree( p ); }
+void operator delete[]( void* p, std::align_val_t, const std::nothrow_t& ) noexcept { trackedFree( p ); }
+
+bool AllocTracker::isEnabled() { return true; }
+
+void AllocTracker::newFrame()
+{
+   gLastFrame = gFrame.exchangeZero();
+   gLastFramePeak = gFramePeak.exchange( gLive.load( std::memory_order_relaxed ) );
+   for( auto& s : gScopes )
+   {
+      if( s.name.load( std::memory_order_acquire ) == nullptr )
+         break;
+      s.lastFrame = s.frame.exchangeZero();
+      s.lastFramePeak = s.framePeak.exchange( size_t( std::max< int64_t >( 0, s.live.load( std::memory_order_relaxed ) ) ) );
+   }
+}
+
+AllocTracker::Stats AllocTracker::lastFrame() { return gLastFrame; }
+AllocTracker::Stats AllocTracker::currentFrame() { return gFrame.load(); }
+AllocTracker::Stats AllocTracker::total() { return gTotal.load(); }
+size_t AllocTracker::liveBytes() { return gLive.load( std::memory_order_relaxed ); }
+size_t AllocTracker::peakBytes() { return gPeak.load( std::memory_order_relaxed ); }
+size_t AllocTracker::peakBytesLastFrame() { return gLastFramePeak; }
+AllocTracker::Stats AllocTracker::threadTotal() { return { tCount, tBytes, tFrees }; }
+
+size_t AllocTracker::getScopes( ScopeStats* out, size_t maxOut )
+{
+   size_t n = 0;
+   for( size_t i = 0; i < MAX_SCOPES && n < maxOut; ++i )
+   {
+      const char* name = gScopes[i].name.load( std::memory_order_acquire );
+      if( name == nullptr )
+         break;
+      const ScopeSlot& s = gScopes[i];
+      size_t live = size_t( std::max< int64_t >( 0, s.live.load( std::memory_order_relaxed ) ) );
+      out[n++] = ScopeStats{ name, s.lastFrame, s.total.load(), live, s.peak.load( std::memory_order_relaxed ), s.lastFramePeak };
+   }
+   return n;
+}
+
+size_t AllocTracker::getTopSites( SiteStats* out, size_t maxOut )
+{
+   //Insertion into a small sorted output array; maxOut is a "top N" for display, so this stays cheap
+   //and, unlike sorting a copy of the whole table, needs no scratch storage.
+   size_t n = 0;
+   for( const auto& s : gSites )
+   {
+      const void* site = s.site.load( std::memory_order_acquire );
+      if( site == nullptr )
+         continue;
+      SiteStats cur{ site, s.scope.load( std::memory_order_relaxed ), s.count.load( std::memory_order_relaxed ), s.bytes.load( std::memory_order_relaxed ) };
+      size_t pos = n;
+      while( pos > 0 && out[pos - 1].count < cur.count )
+         --pos;
+      if( pos >= maxOut )
+         continue;
+      size_t last = ( n < maxOut ) ? n : maxOut - 1;
+      for( size_t j = last; j > pos; --j )
+         out[j] = out[j - 1];
+      out[pos] = cur;
+      if( n < maxOut )
+         ++n;
+   }
+   return n;
+}
+
+void AllocTracker::reset()
+{
+   gFrame.clear();
+   gTotal.clear();
+   gLastFrame = {};
+   gPeak = gLive.load();
+   gFramePeak = gLive.load();
+   gLastFramePeak = 0;
+   //Names and live bytes are state, not counters: open Scopes keep their slot and frees of older
+   //blocks are still charged to the slot stored in their header
+   for( auto& s : gScopes )
+   {
+      s.frame.clear();
+      s.total.clear();
+      s.lastFrame = {};
+      size_t live = size_t( std::max< int64_t >( 0, s.live.load() ) );
+      s.peak = live;
+      s.framePeak = live;
+      s.lastFramePeak = 0;
+   }
+   for( auto& s : gSites )
+   {
+      s.site = nullptr;
+      s.scope = nullptr;
+      s.count = 0;
+      s.bytes = 0;
+   }
+}
+
+AllocTracker::Scope::Scope( const char* name ) : prevSlot( tScopeSlot )
+{
+   int slot = findOrClaimScope( name );
+   if( slot >= 0 )
+      tScopeSlot = slot;
+}
+
+AllocTracker::Scope::~Scope()
+{
+   tScopeSlot = this->prevSlot;
+}
+
+#else //!DISPLACEMENT_GRID_TRACK_ALLOCS
+
+bool AllocTracker::isEnabled() { return false; }
+AllocTracker::Stats AllocTracker::lastFrame() { return {}; }
+AllocTracker::Stats AllocTracker::currentFrame() { return {}; }
+AllocTracker::Stats AllocTracker::total() { return {}; }
+size_t AllocTracker::liveBytes() { return 0; }
+size_t AllocTracker::peakBytes() { return 0; }
+size_t AllocTracker::peakBytesLastFrame() { return 0; }
+AllocTracker::Stats AllocTracker::threadTotal() { return {}; }
+size_t AllocTracker::getScopes( ScopeStats*, size_t ) { return 0; }
+size_t AllocTracker::getTopSites( SiteStats*, size_t ) { return 0; }
+
+#endif //DISPLACEMENT_GRID_TRACK_ALLOCS
@@ -0,0 +1,152 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+//Heap allocation instrumentation. Configure with -DDISPLACEMENT_GRID_TRACK_ALLOCS=ON to replace
+//global operator new/delete with counting versions (see AllocTracker.cpp). When the option is off,
+//every call below compiles to a no-op so call sites do not need their own #ifdefs.
+
+namespace Aftr
+{
+
+/**
+   \class AllocTracker
+   \brief Counts heap allocations, bytes, and live/peak usage per frame, per named scope, and per
+   allocation site (the return address of the operator new call).
+
+   The hooks themselves never allocate; all storage is fixed-size and updated with atomics so
+   worker threads may allocate concurrently. Scope names must be string literals (or otherwise
+   outlive the tracker) since they are keyed by pointer.
+
+   \{
+*/
+class AllocTracker
+{
+public:
+   static constexpr size_t MAX_SCOPES = 64;
+   static constexpr size_t MAX_SITES = 1024;
+
+   struct Stats
+   {
+      uint64_t count = 0;  ///< Number of operator new calls
+      uint64_t bytes = 0;  ///< Bytes requested by those calls
+      uint64_t frees = 0;  ///< Number of operator delete calls on non-null pointers
+   };
+
+   struct ScopeStats
+   {
+      const char* name = nullptr;
+      Stats lastFrame; ///< Allocations made inside this scope during the last completed frame
+      Stats total;     ///< Allocations made inside this scope since startup (or the last reset())
+      size_t liveBytes = 0;          ///< Bytes allocated inside this scope and not yet freed (by any thread)
+      size_t peakBytes = 0;          ///< High-water mark of liveBytes since startup (or the last reset())
+      size_t peakBytesLastFrame = 0; ///< High-water mark of liveBytes during the last completed frame
+   };
+
+   struct SiteStats
+   {
+      const void* site = nullptr;  ///< Return address of the caller of operator new
+      const char* scope = nullptr; ///< Innermost Scope active the first time this site allocated
+      uint64_t count = 0;
+      uint64_t bytes = 0;
+   };
+
+   /// True when built with DISPLACEMENT_GRID_TRACK_ALLOCS, i.e., the global new/delete hooks are live.
+   static bool isEnabled();
+
+   /// Marks a frame boundary: the counters accumulated since the previous call become lastFrame().
+   /// Call once per frame from the main loop (GLViewdisplacement_grid::updateWorld()).
+#ifdef DISPLACEMENT_GRID_TRACK_ALLOCS
+   static void newFrame();
+#else
+   static void newFrame() {}
+#endif
+   static Stats lastFrame();
+   static Stats currentFrame();
+   static Stats total();
+   static size_t liveBytes(); ///< Bytes currently allocated through the hooks
+   static size_t peakBytes(); ///< High-water mark of liveBytes() since startup (or the last reset())
+   static size_t peakBytesLastFrame(); ///< High-water mark of liveBytes() during the last completed frame
+
+   /// Copies up to maxOut scopes into out and returns how many were written.
+   static size_t getScopes( ScopeStats* out, size_t maxOut );
+   /// Copies the maxOut sites with the most allocations into out, sorted descending by count.
+   static size_t getTopSites( SiteStats* out, size_t maxOut );
+
+   /// Clears all totals, per-frame counts, and sites; peaks restart from the current live bytes.
+   /// Scope names stay registered to their slots, so Scopes that are open (such as the one around
+   /// the panel's Reset button) and blocks allocated before the reset stay charged to the right
+   /// scope. Not safe while other threads allocate.
+#ifdef DISPLACEMENT_GRID_TRACK_ALLOCS
+   static void reset();
+#else
+   static void reset() {}
+#endif
+
+   /// Allocation counts made by the calling thread only; used by tests to measure a hot path
+   /// without picking up noise from other threads.
+   static Stats threadTotal();
+
+   /**
+      RAII profiler scope. Allocations made by this thread while a Scope is alive are attributed
+      to its name (the innermost Scope wins when nested).
+   */
+   class Scope
+   {
+   public:
+#ifdef DISPLACEMENT_GRID_TRACK_ALLOCS
+      explicit Scope( const char* name );
+      ~Scope();
+#else
+      explicit Scope( const char* ) {}
+#endif
+      Scope( const Scope& ) = delete;
+      Scope& operator=( const Scope& ) = delete;
+   private:
+#ifdef DISPLACEMENT_GRID_TRACK_ALLOCS
+      int prevSlot = -1;
+#endif
+   };
+
+   /**
+      Measures the allocations made by this thread between construction and get(). Used to assert
+      that a named hot path is allocation free:
+      \code
+         AllocTracker::Counter c;
+         orbit.compute_pose( origin );
+         EXPECT_EQ( c.get().count, 0 ) << "compute_pose allocated";
+      \endcode
+   */
+   class Counter
+   {
+   public:
+      Counter() : start( AllocTracker::threadTotal() ) {}
+      Stats get() const
+      {
+         Stats now = AllocTracker::threadTotal();
+         return Stats{ now.count - start.count, now.bytes - start.bytes, now.frees - start.frees };
+      }
+   private:
+      Stats start;
+   };
+};
+
+/** \} */
+
+} //namespace Aftr
+
+#define AFTR_ALLOC_SCOPE_CAT2( a, b ) a##b
+#define AFTR_ALLOC_SCOPE_CAT( a, b ) AFTR_ALLOC_SCOPE_CAT2( a, b )
+/// Attributes the allocations in the enclosing block to name, e.g., AFTR_ALLOC_SCOPE( "compute_pose" );
+#define AFTR_ALLOC_SCOPE( name ) ::Aftr::AllocTracker::Scope AFTR_ALLOC_SCOPE_CAT( aftrAllocScope_, __LINE__ )( name )
+
+/// For gtests: fails the current test if statement heap-allocates on this thread. Use it to pin a
+/// hot path to zero steady-state allocations; it only measures in a DISPLACEMENT_GRID_TRACK_ALLOCS build.
+#define EXPECT_NO_HEAP_ALLOCS( hotPathName, statement )                                          \
+   do {                                                                                            \
+      ::Aftr::AllocTracker::Counter aftrAllocCounter_;                                             \
+      statement;                                                                                   \
+      ::Aftr::AllocTracker::Stats aftrAllocStats_ = aftrAllocCounter_.get();                       \
+      EXPECT_EQ( aftrAllocStats_.count, 0u ) << hotPathName << " allocated "                       \
+         << aftrAllocStats_.count << " times (" << aftrAllocStats_.bytes << " bytes)";             \
+   } while( 0 )
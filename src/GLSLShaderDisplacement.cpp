@@ -2,6 +2,8 @@
 #include "ManagerShader.h"
 #include "ManagerEnvironmentConfiguration.h"
 #include "GLSLUniform.h"
+#include "Log.h"
+#include <string>
 
 using namespace Aftr;
 
@@ -22,7 +24,10 @@ GLSLShaderDisplacement* GLSLShaderDisplacement::New()
 
     GLSLShaderDataShared* data = ManagerShader::loadShaderDataShared(vert, frag);
     if (data == nullptr)
+    {
+        AFTR_LOG_ERROR("Could not load displacement shader '{}' / '{}'\n", vert, frag);
         return nullptr;
+    }
 
     // Create the shader instance
     GLSLShaderDisplacement* ptr = new GLSLShaderDisplacement(data);
@@ -41,6 +46,18 @@ GLSLShaderDisplacement* GLSLShaderDisplacement::New()
     ptr->speedMultiplier = new GLSLUniform("SpeedMultiplier", utFLOAT, data->getShaderHandle());
     ptr->frequencyMultiplier = new GLSLUniform("FrequencyMultiplier", utFLOAT, data->getShaderHandle());
 
+    // Wake simulation window and scale; w = 0 keeps the wake off until GLViewdisplacement_grid uploads one
+    ptr->wakeParams = new GLSLUniform("WakeParams", utVEC4, data->getShaderHandle());
+    float wakeOff[4] = { 0.0f, 0.0f, 1.0f, 0.0f };
+    ptr->wakeParams->setValues(wakeOff);
+
+    // Infinite ocean levels; OceanGridN stays 0 (off) until GLViewdisplacement_grid enables it
+    ptr->oceanGridN = new GLSLUniform("OceanGridN", utFLOAT, data->getShaderHandle());
+    float gridOff = 0.0f;
+    ptr->oceanGridN->setValues(&gridOff);
+    for (size_t i = 0; i < ptr->oceanLevels.size(); ++i)
+        ptr->oceanLevels[i] = new GLSLUniform("OceanLevels[" + std::to_string(i) + "]", utVEC4, data->getShaderHandle());
+
     return ptr;
 }
 
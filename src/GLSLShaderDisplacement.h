@@ -1,5 +1,6 @@
 #pragma once
 #include "GLSLShaderDefaultGL32.h"
+#include <array>
 
 namespace Aftr { class GLSLShaderDisplacement; }
 
@@ -25,6 +26,11 @@ public:
    GLSLUniform* time = nullptr;  // For animation
    GLSLUniform* speedMultiplier = nullptr;
    GLSLUniform* frequencyMultiplier = nullptr;
+   GLSLUniform* wakeParams = nullptr; // vec4: xy = wake window min corner, z = extent, w = height scale (0 = off)
+
+   // Infinite ocean (OceanClipmap) placement; oceanGridN = 0 draws ordinary meshes
+   GLSLUniform* oceanGridN = nullptr;
+   std::array< GLSLUniform*, 8 > oceanLevels{}; // vec4 per level: xy = snapped min corner, z = cell size, w = trim bits
 };
 
 } // namespace Aftr
@@ -38,11 +38,19 @@
 #include "WOAxesTubes.h"
 #include "AftrTimer.h"
 #include <chrono>
+#include <algorithm>
 #include "GLSLShader.h"
 #include "GLSLUniform.h"
 #include "ManagerShader.h"
 #include "ManagerTex.h"
+#include "TexDataShared.h"
 #include "GLSLShaderDisplacement.h"
+#include "AllocTracker.h"
+#include "Log.h"
+#include "WakeSim.h"
+#include "OceanClipmap.h"
+#include "IndexedGeometryTriangles.h"
+#include "TaskScheduler.h"
 using namespace Aftr;
 
 GLViewdisplacement_grid* GLViewdisplacement_grid::New( const std::vector< std::string >& args )
@@ -73,29 +81,216 @@ GLViewdisplacement_grid::~GLViewdisplacement_grid()
 
 void GLViewdisplacement_grid::updateWorld()
 {
-    GLView::updateWorld();
-
-    // Update time for animation
-    if (this->displacementShader != nullptr && this->displacementShader->time != nullptr)
-    {
-        static float currentTime = 0.0f;
-        currentTime += 0.016f;
-        this->displacementShader->time->setValues(&currentTime);
-
-        // SET DISPLACEMENT SCALE (uniform already exists!)
-        static bool scaleSet = false;
-        if (!scaleSet && this->displacementShader->displacementScale != nullptr)
-        {
-            float scaleValue = 10.0f;  // CHANGE THIS for taller waves!
-            this->displacementShader->displacementScale->setValues(&scaleValue);
-            scaleSet = true;
-        }
-    }
-
-    if (this->gulfstream != nullptr && this->moon != nullptr)
-        this->moon->setPose(
-            this->orbit_gui.compute_pose(this->gulfstream->getModel()->getPose()));
+    AllocTracker::newFrame();
+    if (this->frameGraph == nullptr)
+        this->buildFrameGraph();
+    AFTR_ALLOC_SCOPE("updateWorld");
+    this->scheduler->run(*this->frameGraph);
 }
+
+void GLViewdisplacement_grid::buildFrameGraph()
+{
+   this->scheduler = std::make_unique< TaskScheduler >();
+   this->frameGraph = std::make_unique< TaskGraph >();
+   TaskGraph& g = *this->frameGraph;
+   using Affinity = TaskGraph::Affinity;
+
+   //Moves the camera, the actors, and runs waypoint activation; everything below reads its results
+   auto base = g.add( "GLView::updateWorld", [this]()
+      {
+         AFTR_ALLOC_SCOPE( "GLView::updateWorld" );
+         this->GLView::updateWorld();
+         this->frameCamPos = this->cam->getPosition();
+      }, Affinity::MainThread );
+
+   auto waveTime = g.add( "waveTime", [this]() { this->waveTime += FRAME_DT; } );
+   g.add( "waveUniforms", [this]() { this->uploadWaveUniforms(); }, { waveTime }, Affinity::MainThread );
+
+   //The moon orbits the Gulfstream's pose as of this frame
+   auto moonPose = g.add( "moonPose", [this]()
+      {
+         if( this->gulfstream != nullptr && this->moon != nullptr )
+         {
+            AFTR_ALLOC_SCOPE( "orbit_gui.compute_pose" );
+            this->moon->setPose( this->orbit_gui.compute_pose( this->gulfstream->getModel()->getPose() ) );
+         }
+      }, { base } );
+
+   //The wake step runs as row bands on the scheduler's threads (WakeSim has no threads of its own);
+   //each substep's bands are independent and must all finish before the buffers swap
+   auto wakeDone = g.add( "wakePrepare", [this]() { this->prepareWakeStep( FRAME_DT ); }, { base, moonPose, waveTime } );
+   if( this->wake != nullptr )
+   {
+      int bands = std::min( int( 2 * this->scheduler->getThreadCount() ), this->wake->getSize() );
+      for( int s = 0; s < this->wake->getSubstepCount( FRAME_DT ); ++s )
+      {
+         auto swap = g.add( "wakeEndSubstep", [this]() { if( this->wakeStepping ) this->wake->endSubstep(); } );
+         for( int b = 0; b < bands; ++b )
+            g.precede( g.add( "wakeBand", [this, b, bands]() { if( this->wakeStepping ) this->wake->stepBand( b, bands ); }, { wakeDone } ), swap );
+         wakeDone = swap;
+      }
+   }
+   g.add( "wakeUpload", [this]() { this->uploadWake(); }, { wakeDone }, Affinity::MainThread );
+
+   auto oceanPlacement = g.add( "oceanPlacement", [this]() { this->placeOcean(); }, { base } );
+   g.add( "oceanUpload", [this]() { this->uploadOcean(); }, { oceanPlacement }, Affinity::MainThread );
+}
+
+void GLViewdisplacement_grid::uploadWaveUniforms()
+{
+   if( this->displacementShader == nullptr || this->displacementShader->time == nullptr )
+      return;
+   this->displacementShader->time->setValues( &this->waveTime );
+
+   // SET DISPLACEMENT SCALE (uniform already exists!)
+   static bool scaleSet = false;
+   if( !scaleSet && this->displacementShader->displacementScale != nullptr )
+   {
+      float scaleValue = 10.0f;  // CHANGE THIS for taller waves!
+      this->displacementShader->displacementScale->setValues( &scaleValue );
+      scaleSet = true;
+   }
+}
+
+void GLViewdisplacement_grid::prepareWakeStep( float dt )
+{
+   this->wakeStepping = this->wake != nullptr && this->orbit_gui.wakeEnabled;
+   if( !this->wakeStepping )
+      return;
+   AFTR_ALLOC_SCOPE( "prepareWakeStep" );
+   this->wake->recenter( this->frameCamPos.x, this->frameCamPos.y );
+   this->disturbWake( this->gulfstream, 6.0f );
+   this->disturbWake( this->moon, 3.0f );
+   this->wake->beginStep( dt );
+}
+
+void GLViewdisplacement_grid::uploadWake()
+{
+   if( this->wake == nullptr || this->displacementShader == nullptr || this->displacementShader->wakeParams == nullptr )
+      return;
+   AFTR_ALLOC_SCOPE( "uploadWake" );
+
+   float params[4] = { 0.0f, 0.0f, 1.0f, 0.0f };
+   if( this->orbit_gui.wakeEnabled )
+   {
+      //Direct state access: no texture unit or binding changes behind the renderer's back
+      int n = this->wake->getSize();
+      glTextureSubImage2D( this->wakeTex, 0, 0, 0, n, n, GL_RED, GL_FLOAT, this->wake->getHeights() );
+
+      params[0] = this->wake->getOriginX();
+      params[1] = this->wake->getOriginY();
+      params[2] = this->wake->getExtent();
+      params[3] = this->orbit_gui.wakeHeightScale;
+   }
+   this->displacementShader->wakeParams->setValues( params );
+}
+
+Tex GLViewdisplacement_grid::createWakeTexture()
+{
+   int n = this->wake->getSize();
+   glCreateTextures( GL_TEXTURE_2D, 1, &this->wakeTex );
+   glTextureStorage2D( this->wakeTex, 1, GL_R32F, n, n );
+   glTextureParameteri( this->wakeTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTextureParameteri( this->wakeTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTextureParameteri( this->wakeTex, GL_TEXTURE_WRAP_S, GL_REPEAT ); //storage is toroidal, see WakeSim
+   glTextureParameteri( this->wakeTex, GL_TEXTURE_WRAP_T, GL_REPEAT );
+   float zeros[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+   glClearTexImage( this->wakeTex, 0, GL_RED, GL_FLOAT, zeros );
+   //The skins bind it for each draw like any other texture. The TexDataShared owns the GL name and
+   //deletes it with the last Tex; wakeTex is only a handle for uploads
+   return Tex( new TexDataShared( this->wakeTex, n, n, GL_TEXTURE_2D ) );
+}
+
+void GLViewdisplacement_grid::disturbWake( WO* wo, float radius )
+{
+   if( wo == nullptr )
+      return;
+   //The water rests at z = 0; objects within REACH meters of it push it down, harder when closer
+   constexpr float REACH = 15.0f;
+   Vector p = wo->getPosition();
+   float above = std::max( 0.0f, p.z );
+   if( above < REACH )
+      this->wake->disturb( p.x, p.y, radius, 0.05f * ( 1.0f - above / REACH ) );
+}
+
+void GLViewdisplacement_grid::placeOcean()
+{
+   if( this->clipmap == nullptr || !this->orbit_gui.infiniteOcean )
+      return;
+   //Only re-upload when the camera crossed a snapping boundary of some level
+   this->oceanPlacementChanged = this->clipmap->update( this->frameCamPos.x, this->frameCamPos.y );
+}
+
+void GLViewdisplacement_grid::uploadOcean()
+{
+   if( this->clipmap == nullptr || this->ocean == nullptr || this->grid == nullptr ||
+       this->displacementShader == nullptr || this->displacementShader->oceanGridN == nullptr )
+      return;
+   AFTR_ALLOC_SCOPE( "uploadOcean" );
+
+   bool show = this->orbit_gui.infiniteOcean;
+   bool modeChanged = ( show != this->oceanShown );
+   if( modeChanged )
+   {
+      this->ocean->isVisible = show;
+      this->grid->isVisible = !show;
+      float gridN = show ? float( this->clipmap->getGridCells() ) : 0.0f;
+      this->displacementShader->oceanGridN->setValues( &gridN );
+      this->oceanShown = show;
+   }
+   if( !show )
+      return;
+
+   if( this->oceanPlacementChanged || modeChanged )
+   {
+      for( int L = 0; L < this->clipmap->getLevelCount(); ++L )
+      {
+         const OceanClipmap::LevelPlacement& p = this->clipmap->getPlacement( L );
+         float v[4] = { float( p.originX() ), float( p.originY() ), p.cellSize, float( p.trimBits ) };
+         this->displacementShader->oceanLevels[L]->setValues( v );
+      }
+   }
+}
+
+WO* GLViewdisplacement_grid::createInfiniteOcean( float farPlane )
+{
+   OceanClipmap::Config cfg;
+   cfg.gridCells = 128;
+   cfg.baseCellSize = 1.0f;
+   cfg.farDistance = farPlane;
+   this->clipmap = std::make_unique< OceanClipmap >( cfg );
+
+   //Positions hold (ix, iy, level) and texcoord.u the vertex kind; displacement_circ.vert places
+   //them each frame from OceanLevels, so these buffers never change
+   std::vector< OceanClipmap::GridVertex > gridVerts;
+   std::vector< uint32_t > gridIndices;
+   this->clipmap->buildMesh( gridVerts, gridIndices );
+   std::vector< Vector > verts;
+   std::vector< aftrTexture4f > texCoords;
+   std::vector< aftrColor4ub > colors;
+   verts.reserve( gridVerts.size() );
+   texCoords.reserve( gridVerts.size() );
+   colors.reserve( gridVerts.size() );
+   for( const auto& v : gridVerts )
+   {
+      verts.emplace_back( v.ix, v.iy, v.level );
+      texCoords.emplace_back( v.kind, 0.0f );
+      colors.emplace_back( 255, 255, 255, 255 );
+   }
+   std::vector< unsigned int > indices( gridIndices.begin(), gridIndices.end() );
+
+   WO* wo = WO::New();
+   MGLIndexedGeometry* mgl = MGLIndexedGeometry::New( wo );
+   mgl->setIndexedGeometry( IndexedGeometryTriangles::New( verts, indices, texCoords, colors ) );
+   wo->setModel( mgl );
+   wo->setLabel( "Infinite Ocean" );
+   wo->renderOrderType = RENDER_ORDER_TYPE::roOPAQUE;
+   wo->isVisible = false;
+   AFTR_LOG_INFO( "Infinite ocean: {} levels, {} vertices, reaches {:.0f} m\n",
+      this->clipmap->getLevelCount(), verts.size(), this->clipmap->getReach() );
+   return wo;
+}
+
 void GLViewdisplacement_grid::onResizeWindow( GLsizei width, GLsizei height )
 {
    GLView::onResizeWindow( width, height );
@@ -134,7 +329,8 @@ void Aftr::GLViewdisplacement_grid::loadMap()
    this->actorLst = new WorldList();
    this->netLst = new WorldList();
 
-   ManagerOpenGLState::GL_CLIPPING_PLANE( 1000.0 );
+   const float farPlane = 1000.0f;
+   ManagerOpenGLState::GL_CLIPPING_PLANE( farPlane );
    ManagerOpenGLState::GL_NEAR_PLANE( 0.1f );
    ManagerOpenGLState::enableFrustumCulling( false );
    Axes::isVisible = true;
@@ -199,7 +395,7 @@ void Aftr::GLViewdisplacement_grid::loadMap()
       this->moon->renderOrderType = RENDER_ORDER_TYPE::roTRANSPARENT;
       this->worldLst->push_back( this->moon );
 
-      fmt::print( "To the moon...\n" );
+      AFTR_LOG_INFO( "To the moon...\n" );
       Tex tex = *ManagerTex::loadTexAsync( ManagerEnvironmentConfiguration::getSMM() + "/images/moonMap.jpg" );
       this->moon->getModel()->getSkin().getMultiTextureSet().at( 0 ) = tex;
       this->moon->setPosition( {15,2,10});
@@ -213,25 +409,37 @@ void Aftr::GLViewdisplacement_grid::loadMap()
    // In GLViewdisplacement_grid.cpp loadMap() function:
 
    {
-       fmt::print("\n=== Creating Displacement Mapped Grid ===\n");
+       AFTR_LOG_INFO("\n=== Creating Displacement Mapped Grid ===\n");
 
        // Create grass plane
        WO* grid = WO::New(grass, Vector(1, 1, 1), MESH_SHADING_TYPE::mstFLAT);
+       this->grid = grid;
        grid->setPosition(Vector(0, 0, 0));
        grid->setLabel("Displacement Grid");
+
+       // Ripple simulation the aircraft and moon disturb; it follows the camera (see prepareWakeStep())
+       WakeSim::Config wakeCfg;
+       wakeCfg.size = 256;
+       wakeCfg.cellSize = 1.0f;
+       this->wake = std::make_unique< WakeSim >(wakeCfg);
+       Tex wakeMap = this->createWakeTexture();
        grid->renderOrderType = RENDER_ORDER_TYPE::roOPAQUE;
        worldLst->push_back(grid);
 
+       // Camera-following replacement for the fixed grid, toggled by "Infinite Ocean" in Wave Controls
+       this->ocean = this->createInfiniteOcean(farPlane);
+       worldLst->push_back(this->ocean);
+
        /// Apply displacement shader when model loads
-       grid->upon_async_model_loaded([this, grid]()
+       grid->upon_async_model_loaded([this, grid, wakeMap]()
            {
-               fmt::print("Applying displacement shader...\n");
+               AFTR_LOG_INFO("Applying displacement shader...\n");
 
                // Create custom displacement shader
                GLSLShaderDisplacement* shader = GLSLShaderDisplacement::New();
                if (shader == nullptr)
                {
-                   fmt::print("ERROR: Failed to create displacement shader!\n");
+                   AFTR_LOG_ERROR("Failed to create displacement shader!\n");
                    return;
                }
                this->displacementShader = shader;
@@ -242,16 +450,16 @@ void Aftr::GLViewdisplacement_grid::loadMap()
                auto heightmapOpt = ManagerTex::loadTexAsync(heightmapPath);
                if (!heightmapOpt.has_value())
                {
-                   fmt::print("ERROR: Failed to load heightmap!\n");
+                   AFTR_LOG_ERROR("Failed to load heightmap!\n");
                    return;
                }
                Tex heightmap = *heightmapOpt;
 
-               fmt::print("Heightmap loaded successfully!\n");
+               AFTR_LOG_INFO("Heightmap loaded successfully!\n");
 
                // Apply shader to all meshes
                auto& meshes = grid->getModel()->getModelDataShared()->getModelMeshes();
-               fmt::print("Applying to {} meshes...\n", meshes.size());
+               AFTR_LOG_INFO("Applying to {} meshes...\n", meshes.size());
 
                for (auto* mesh : meshes)
                {
@@ -260,19 +468,29 @@ void Aftr::GLViewdisplacement_grid::loadMap()
                        // Set the custom shader
                        skin.setShader(shader);
 
-                       // Add heightmap to texture unit 1
+                       // Add heightmap to texture unit 1 and the wake heights to unit 2
                        auto& texSet = skin.getMultiTextureSet();
-                       if (texSet.size() < 2)
-                           texSet.resize(2);
+                       if (texSet.size() < 3)
+                           texSet.resize(3);
                        texSet.at(1) = heightmap;
+                       texSet.at(2) = wakeMap;
 
-                       fmt::print("  Texture applied to skin!\n");
+                       AFTR_LOG_DEBUG("  Texture applied to skin!\n");
                    }
                }
-               fmt::print("Displacement shader applied!\n");
+               // The infinite ocean shares the shader, heightmap, and wake
+               ModelMeshSkin& oceanSkin = this->ocean->getModel()->getSkin();
+               oceanSkin.setShader(shader);
+               auto& oceanTexSet = oceanSkin.getMultiTextureSet();
+               if (oceanTexSet.size() < 3)
+                   oceanTexSet.resize(3);
+               oceanTexSet.at(1) = heightmap;
+               oceanTexSet.at(2) = wakeMap;
+
+               AFTR_LOG_INFO("Displacement shader applied!\n");
            });
 
-       fmt::print("Grass grid created, waiting for model load...\n");
+       AFTR_LOG_INFO("Grass grid created, waiting for model load...\n");
    }
 
    {
@@ -284,14 +502,18 @@ void Aftr::GLViewdisplacement_grid::loadMap()
       auto showDemoWindow_AftrDemo  = [this]() { WOImGui::draw_AftrImGui_Demo(this->gui); };
       auto showDemoWindow_ImGuiPlot = [this]() { ImPlot::ShowDemoWindow(); };
       auto show_moon_orbit_params   = [this]() { this->orbit_gui.draw(); };
+      auto show_alloc_panel         = [this]() { this->alloc_gui.draw(); };
+      //Attached once here; re-attaching every frame rebuilds the labels and callbacks on the heap
+      menu.attach( "Edit", "Show WO Editor", woEditFunc );
+      menu.attach( "Demos", "Show Default ImGui Demo", showDemoWindow_ImGui );
+      menu.attach( "Demos", "Show Default ImPlot Demo", showDemoWindow_ImGuiPlot );
+      menu.attach( "Demos", "Show Aftr ImGui w/ Markdown & File Dialogs", showDemoWindow_AftrDemo );
+      menu.attach( "Orbit Gui", "Show Orbit", show_moon_orbit_params, true );
+      menu.attach( "Profiling", "Show Heap Allocations", show_alloc_panel );
       this->gui->subscribe_drawImGuiWidget(
-         [=,this]()
+         [this]()
          {
-            menu.attach( "Edit", "Show WO Editor", woEditFunc );
-            menu.attach( "Demos", "Show Default ImGui Demo", showDemoWindow_ImGui );
-            menu.attach( "Demos", "Show Default ImPlot Demo", showDemoWindow_ImGuiPlot );
-            menu.attach( "Demos", "Show Aftr ImGui w/ Markdown & File Dialogs", showDemoWindow_AftrDemo );
-            menu.attach( "Orbit Gui", "Show Orbit", show_moon_orbit_params, true );
+            AFTR_ALLOC_SCOPE( "gui.menu" );
             menu.draw();
          } );
       this->worldLst->push_back( this->gui );
@@ -4,9 +4,11 @@
 #include "AftrImGui_MenuBar.h"
 #include "AftrImGui_WO_Editor.h"
 #include "AftrImGui_displacement_grid.h"
+#include "AftrImGui_AllocTracker.h"
+#include <memory>
 
 
-namespace Aftr { class GLSLShaderDisplacement; }
+namespace Aftr { class GLSLShaderDisplacement; class Tex; class WakeSim; class OceanClipmap; class TaskGraph; class TaskScheduler; }
 
 namespace Aftr
 {
@@ -43,14 +45,37 @@ public:
 protected:
    GLViewdisplacement_grid( const std::vector< std::string >& args );
    virtual void onCreate();
+   static constexpr float FRAME_DT = 0.016f; ///< Simulated time per frame for the waves and the wake
+   void buildFrameGraph(); ///< The stages of updateWorld() and their order, run by scheduler every frame
+   void uploadWaveUniforms(); ///< Pushes waveTime (and the initial displacement scale) to the shader
+   void prepareWakeStep( float dt ); ///< Recenters and disturbs the wake and begins a step whose row bands are frame graph tasks; no GL
+   void uploadWake(); ///< Uploads the wake heights for the displacement shader
+   Tex createWakeTexture(); ///< Allocates wakeTex for wake's size; the skins bind it as texture 2 (WakeMap)
+   void disturbWake( WO* wo, float radius ); ///< Lets wo disturb the water if it is close enough
+   void placeOcean(); ///< Snaps the infinite ocean's levels under the camera; no GL
+   void uploadOcean(); ///< Switches between the fixed grid and the infinite ocean and uploads its placement
+   WO* createInfiniteOcean( float farPlane ); ///< Builds the clipmap's fixed mesh once
 
    WOImGui* gui = nullptr; //The GUI which contains all ImGui widgets
    AftrImGui_MenuBar menu;      //The Menu bar at the top of the GUI window
    AftrImGui_WO_Editor wo_editor;//The WO Editor to mutate a selected WO
    AftrImGui_displacement_grid orbit_gui;
+   AftrImGui_AllocTracker alloc_gui; //Heap allocation panel, populated when built with DISPLACEMENT_GRID_TRACK_ALLOCS
    WO* moon = nullptr;
    WO* gulfstream = nullptr;
    GLSLShaderDisplacement* displacementShader = nullptr;
+   std::unique_ptr< WakeSim > wake; //Camera-following ripple simulation added to the ocean displacement
+   bool wakeStepping = false;       //Set by prepareWakeStep(); the band tasks of this frame's step run only if set
+   GLuint wakeTex = 0;              //R32F texture holding wake's heights, texture 2 of the grid and ocean skins; not owned, the skins' Tex deletes it
+   WO* grid = nullptr;              //Fixed 400x400 displacement grid
+   WO* ocean = nullptr;             //Infinite ocean mesh, shown instead of grid when orbit_gui.infiniteOcean is set
+   std::unique_ptr< OceanClipmap > clipmap; //Placement of ocean's levels around the camera
+   bool oceanShown = false;         //Which of grid/ocean the shader is currently configured for
+   bool oceanPlacementChanged = false; //Set by placeOcean() when a level snapped this frame
+   std::unique_ptr< TaskScheduler > scheduler; //Work-stealing threads that run frameGraph
+   std::unique_ptr< TaskGraph > frameGraph;    //updateWorld()'s stages; GL work is pinned to the main thread
+   float waveTime = 0.0f;           //Animation time fed to the displacement shader
+   Vector frameCamPos;              //Camera position after GLView::updateWorld(), read by the worker stages
 };
 
 /** \} */
@@ -0,0 +1,288 @@
+#include "Log.h"
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+using namespace Aftr;
+
+namespace
+{
+   constexpr size_t MAX_LOGGING_THREADS = 128;
+   constexpr size_t RING_MASK = Log::LOG_RING_CAPACITY - 1;
+   static_assert( ( Log::LOG_RING_CAPACITY & RING_MASK ) == 0, "LOG_RING_CAPACITY must be a power of two" );
+
+   struct Ring
+   {
+      Log::Record slots[Log::LOG_RING_CAPACITY];
+      alignas( 64 ) std::atomic< size_t > head{ 0 }; //next slot the writer reads
+      alignas( 64 ) std::atomic< size_t > tail{ 0 }; //next slot the owning thread writes
+      std::atomic< bool > retired{ false };          //owning thread exited; reusable once drained
+   };
+
+   struct Backend
+   {
+      std::mutex lifecycleMutex; //guards ring registration and writer start/stop
+      std::mutex sinkMutex;      //held by the writer while it emits; setSink() swaps under it
+      std::mutex waitMutex;      //guards wakeRequested for the writer's sleep
+      std::condition_variable wake;
+      bool wakeRequested = false;
+      std::atomic< bool > writerSleeping{ false };
+      std::thread writer;
+      std::atomic< bool > running{ false };
+      std::atomic< bool > stopRequested{ false };
+      Ring* rings[MAX_LOGGING_THREADS] = {};
+      std::atomic< size_t > ringCount{ 0 };
+      std::atomic< uint64_t > dropped{ 0 };
+      uint64_t droppedReported = 0;
+      Log::Sink sink;
+
+      ~Backend();
+   };
+
+   Backend& backend()
+   {
+      static Backend b;
+      return b;
+   }
+
+   thread_local Ring* tRing = nullptr;
+
+   //Hands the thread's ring back when the thread exits. Messages still queued in it are written
+   //first; registerThisThread() only reuses a retired ring once the writer has drained it.
+   struct RingRelease
+   {
+      ~RingRelease()
+      {
+         if( tRing != nullptr )
+            tRing->retired.store( true, std::memory_order_release );
+         tRing = nullptr;
+      }
+   };
+   thread_local RingRelease tRingRelease;
+
+   void wakeWriter( Backend& b )
+   {
+      {
+         std::lock_guard< std::mutex > lk( b.waitMutex );
+         b.wakeRequested = true;
+      }
+      b.wake.notify_one();
+   }
+
+   bool anyQueued( Backend& b )
+   {
+      size_t nRings = b.ringCount.load( std::memory_order_acquire );
+      for( size_t i = 0; i < nRings; ++i )
+         if( b.rings[i]->head.load( std::memory_order_relaxed ) != b.rings[i]->tail.load( std::memory_order_seq_cst ) )
+            return true;
+      return false;
+   }
+
+   const char* levelPrefix( LogLevel lvl )
+   {
+      switch( lvl )
+      {
+         case LogLevel::Trace: return "[TRACE] ";
+         case LogLevel::Debug: return "[DEBUG] ";
+         case LogLevel::Warn:  return "WARNING: ";
+         case LogLevel::Error: return "ERROR: ";
+         default:              return "";
+      }
+   }
+
+   void emit( Backend& b, LogLevel lvl, const fmt::memory_buffer& buf )
+   {
+      std::string_view msg( buf.data(), buf.size() );
+      if( b.sink )
+         b.sink( lvl, msg );
+      else
+         std::fwrite( msg.data(), 1, msg.size(), stdout );
+   }
+
+   //Writes everything currently queued; returns the number of records written.
+   size_t drainAll( Backend& b, fmt::memory_buffer& buf )
+   {
+      std::lock_guard< std::mutex > lk( b.sinkMutex );
+      size_t written = 0;
+      size_t nRings = b.ringCount.load( std::memory_order_acquire );
+      for( size_t i = 0; i < nRings; ++i )
+      {
+         Ring& r = *b.rings[i];
+         size_t h = r.head.load( std::memory_order_relaxed );
+         size_t t = r.tail.load( std::memory_order_acquire );
+         for( ; h != t; ++h )
+         {
+            Log::Record& rec = r.slots[h & RING_MASK];
+            buf.clear();
+            const char* prefix = levelPrefix( rec.site->level );
+            buf.append( std::string_view( prefix ) );
+            rec.formatAndDestroy( buf, rec.fmtStr, rec.args );
+            if( rec.suppressed > 0 )
+               fmt::format_to( std::back_inserter( buf ), "   (+{} similar suppressed)\n", rec.suppressed );
+            emit( b, rec.site->level, buf );
+            r.head.store( h + 1, std::memory_order_release );
+            ++written;
+         }
+      }
+      uint64_t dropped = b.dropped.load( std::memory_order_relaxed );
+      if( dropped != b.droppedReported )
+      {
+         buf.clear();
+         fmt::format_to( std::back_inserter( buf ), "WARNING: log ring full, {} messages dropped\n", dropped - b.droppedReported );
+         emit( b, LogLevel::Warn, buf );
+         b.droppedReported = dropped;
+      }
+      if( written > 0 && !b.sink )
+         std::fflush( stdout );
+      return written;
+   }
+
+   //Sleeps without a timeout once every ring is empty. writerSleeping is published before the
+   //final check of the rings and Log::commitRecord() publishes its tail before reading
+   //writerSleeping (both seq_cst), so either the writer sees the new record or the producer sees
+   //the writer asleep and wakes it.
+   void writerLoop( Backend* b )
+   {
+      fmt::memory_buffer buf;
+      while( !b->stopRequested.load( std::memory_order_acquire ) )
+      {
+         if( drainAll( *b, buf ) > 0 )
+            continue;
+         std::unique_lock< std::mutex > lk( b->waitMutex );
+         b->writerSleeping.store( true, std::memory_order_seq_cst );
+         if( !anyQueued( *b ) )
+            b->wake.wait( lk, [b]() { return b->wakeRequested || b->stopRequested.load( std::memory_order_acquire ); } );
+         b->wakeRequested = false;
+         b->writerSleeping.store( false, std::memory_order_relaxed );
+      }
+      drainAll( *b, buf );
+   }
+
+   void stopWriter( Backend& b )
+   {
+      std::lock_guard< std::mutex > lk( b.lifecycleMutex );
+      if( !b.running.load() )
+         return;
+      b.stopRequested.store( true, std::memory_order_release );
+      wakeWriter( b );
+      b.writer.join();
+      b.running = false;
+   }
+
+   //Static destruction: stop the writer through this reference, never through backend()
+   Backend::~Backend()
+   {
+      stopWriter( *this );
+      for( size_t i = 0; i < ringCount.load(); ++i )
+         delete rings[i];
+   }
+
+   void ensureWriterRunning( Backend& b )
+   {
+      std::lock_guard< std::mutex > lk( b.lifecycleMutex );
+      if( b.running.load() )
+         return;
+      b.stopRequested = false;
+      b.writer = std::thread( writerLoop, &b );
+      b.running = true;
+   }
+
+   Ring* registerThisThread()
+   {
+      (void)&tRingRelease; //first use on this thread constructs it, so its destructor runs at exit
+      Backend& b = backend();
+      std::lock_guard< std::mutex > lk( b.lifecycleMutex );
+      size_t n = b.ringCount.load( std::memory_order_relaxed );
+      for( size_t i = 0; i < n; ++i )
+      {
+         Ring* r = b.rings[i];
+         if( r->retired.load( std::memory_order_acquire ) &&
+             r->head.load( std::memory_order_acquire ) == r->tail.load( std::memory_order_relaxed ) )
+         {
+            r->retired.store( false, std::memory_order_relaxed );
+            return r;
+         }
+      }
+      if( n == MAX_LOGGING_THREADS )
+         return nullptr;
+      b.rings[n] = new Ring();
+      b.ringCount.store( n + 1, std::memory_order_release );
+      return b.rings[n];
+   }
+}
+
+bool Log::passRateLimit( LogSite& site )
+{
+   int64_t now = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+   int64_t last = site.lastEmitNs.load( std::memory_order_relaxed );
+   if( now - last >= site.minIntervalNs && site.lastEmitNs.compare_exchange_strong( last, now, std::memory_order_relaxed ) )
+      return true;
+   site.suppressed.fetch_add( 1, std::memory_order_relaxed );
+   return false;
+}
+
+Log::Record* Log::beginRecord()
+{
+   Backend& b = backend();
+   if( !b.running.load( std::memory_order_relaxed ) )
+      ensureWriterRunning( b );
+   if( tRing == nullptr && ( tRing = registerThisThread() ) == nullptr )
+   {
+      b.dropped.fetch_add( 1, std::memory_order_relaxed );
+      return nullptr;
+   }
+   size_t t = tRing->tail.load( std::memory_order_relaxed );
+   if( t - tRing->head.load( std::memory_order_acquire ) >= LOG_RING_CAPACITY )
+   {
+      b.dropped.fetch_add( 1, std::memory_order_relaxed );
+      return nullptr;
+   }
+   return &tRing->slots[t & RING_MASK];
+}
+
+void Log::commitRecord()
+{
+   //seq_cst pairs with writerLoop()'s writerSleeping store; see there
+   tRing->tail.fetch_add( 1, std::memory_order_seq_cst );
+   Backend& b = backend();
+   if( b.writerSleeping.load( std::memory_order_seq_cst ) )
+      wakeWriter( b );
+}
+
+void Log::setSink( Sink sink )
+{
+   Backend& b = backend();
+   std::lock_guard< std::mutex > lk( b.sinkMutex );
+   b.sink = std::move( sink );
+}
+
+void Log::flush()
+{
+   Backend& b = backend();
+   if( !b.running.load() )
+      return;
+   size_t targets[MAX_LOGGING_THREADS];
+   size_t nRings = b.ringCount.load( std::memory_order_acquire );
+   for( size_t i = 0; i < nRings; ++i )
+      targets[i] = b.rings[i]->tail.load( std::memory_order_acquire );
+   for( size_t i = 0; i < nRings; ++i )
+   {
+      while( b.rings[i]->head.load( std::memory_order_acquire ) < targets[i] )
+      {
+         wakeWriter( b );
+         std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+      }
+   }
+   std::lock_guard< std::mutex > lk( b.sinkMutex ); //wait for the writer to finish emitting the last record
+}
+
+void Log::shutdown()
+{
+   stopWriter( backend() );
+}
+
+uint64_t Log::droppedCount()
+{
+   return backend().dropped.load( std::memory_order_relaxed );
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <fmt/format.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+//Asynchronous, leveled logging. Call sites look like fmt::print:
+//
+//   AFTR_LOG_INFO( "Speed multiplier set to {:f} (2^{:f})\n", speed, this->speedPower );
+//   AFTR_LOG_INFO_EVERY( 250, "Radius {:f}\n", this->radius_m ); //at most once per 250 ms per site
+//
+//The format string is checked at compile time. The call site only copies its arguments into a
+//lock-free ring owned by the calling thread; a background thread formats and writes them.
+//Levels below DISPLACEMENT_GRID_LOG_LEVEL are discarded by `if constexpr` and cost nothing.
+//
+//Arguments are captured by value. A `const char*` is captured as a pointer, so pass string
+//literals or a std::string (copied) -- never a pointer into a buffer that may be freed.
+
+#ifndef DISPLACEMENT_GRID_LOG_LEVEL
+   #define DISPLACEMENT_GRID_LOG_LEVEL 2 //Info; see Aftr::LogLevel
+#endif
+
+namespace Aftr
+{
+
+enum class LogLevel : int { Trace = 0, Debug, Info, Warn, Error, Off };
+
+/// Static per-call-site state created by the AFTR_LOG_* macros.
+struct LogSite
+{
+   LogLevel level;
+   int64_t minIntervalNs;                         ///< 0 means not rate limited
+   std::atomic< int64_t > lastEmitNs{ INT64_MIN / 2 }; ///< steady_clock time of the last emitted message
+   std::atomic< uint32_t > suppressed{ 0 };       ///< Messages dropped by the rate limit since the last emit
+};
+
+/**
+   \class Log
+   \brief Owns the background writer thread and the per-thread ring buffers.
+
+   Each thread that logs gets a single-producer/single-consumer ring of LOG_RING_CAPACITY records
+   the first time it logs. When a ring is full the message is dropped (never blocks) and counted;
+   the writer reports the number of drops. At most 128 threads hold a ring at once; a thread's
+   ring is reused after the thread exits and its messages have been written.
+
+   The writer starts lazily on the first message and sleeps while every ring is empty; the message
+   that makes a ring non-empty wakes it. It is flushed and joined by shutdown(), or at static
+   destruction if shutdown() was never called.
+
+   \{
+*/
+class Log
+{
+public:
+   static constexpr size_t LOG_RING_CAPACITY = 1024;   ///< Records per thread, power of two
+   static constexpr size_t LOG_ARG_BYTES = 96;         ///< In-place storage for a call's arguments
+
+   using Sink = std::function< void( LogLevel, std::string_view ) >;
+
+   static constexpr bool enabled( LogLevel lvl ) { return int( lvl ) >= DISPLACEMENT_GRID_LOG_LEVEL; }
+
+   /// Replaces the output sink (default writes to stdout). The sink is only invoked on the writer thread.
+   static void setSink( Sink sink );
+   /// Blocks until every message enqueued before this call has been written.
+   static void flush();
+   /// Flushes and joins the writer thread. Logging afterwards restarts it.
+   static void shutdown();
+   /// Messages dropped because a thread's ring was full, since startup.
+   static uint64_t droppedCount();
+
+   template< typename... Args >
+   static void write( LogSite& site, fmt::format_string< Args... > fmtStr, Args&&... args )
+   {
+      if( site.minIntervalNs > 0 && !passRateLimit( site ) )
+         return;
+      using Tuple = std::tuple< std::decay_t< Args >... >;
+      static_assert( sizeof( Tuple ) <= LOG_ARG_BYTES, "Too many/large log arguments; format them before logging" );
+      static_assert( alignof( Tuple ) <= alignof( std::max_align_t ), "Over-aligned log argument" );
+      Record* r = beginRecord();
+      if( r == nullptr )
+         return;
+      r->site = &site;
+      r->fmtStr = fmt::string_view( fmtStr );
+      r->suppressed = site.minIntervalNs > 0 ? site.suppressed.exchange( 0, std::memory_order_relaxed ) : 0;
+      r->formatAndDestroy = &formatAndDestroy< Tuple >;
+      new( r->args ) Tuple( std::forward< Args >( args )... );
+      commitRecord();
+   }
+
+   struct Record
+   {
+      const LogSite* site;
+      fmt::string_view fmtStr;
+      uint32_t suppressed;
+      void ( *formatAndDestroy )( fmt::memory_buffer& out, fmt::string_view fmtStr, void* args );
+      alignas( std::max_align_t ) unsigned char args[LOG_ARG_BYTES];
+   };
+
+private:
+   static bool passRateLimit( LogSite& site );
+   static Record* beginRecord(); ///< Slot in this thread's ring, or nullptr if full
+   static void commitRecord();   ///< Publishes the slot returned by beginRecord()
+
+   template< typename Tuple >
+   static void formatAndDestroy( fmt::memory_buffer& out, fmt::string_view fmtStr, void* args )
+   {
+      Tuple* t = static_cast< Tuple* >( args );
+      std::apply( [&]( auto&... a ) { fmt::vformat_to( std::back_inserter( out ), fmtStr, fmt::make_format_args( a... ) ); }, *t );
+      t->~Tuple();
+   }
+};
+
+/** \} */
+
+} //namespace Aftr
+
+#define AFTR_LOG_AT( lvl, intervalMs, ... )                                                      \
+   do {                                                                                          \
+      if constexpr( ::Aftr::Log::enabled( lvl ) )                                                \
+      {                                                                                          \
+         static ::Aftr::LogSite aftrLogSite_{ lvl, int64_t( intervalMs ) * 1000000 };            \
+         ::Aftr::Log::write( aftrLogSite_, __VA_ARGS__ );                                        \
+      }                                                                                          \
+   } while( 0 )
+
+#define AFTR_LOG_TRACE( ... ) AFTR_LOG_AT( ::Aftr::LogLevel::Trace, 0, __VA_ARGS__ )
+#define AFTR_LOG_DEBUG( ... ) AFTR_LOG_AT( ::Aftr::LogLevel::Debug, 0, __VA_ARGS__ )
+#define AFTR_LOG_INFO( ... )  AFTR_LOG_AT( ::Aftr::LogLevel::Info,  0, __VA_ARGS__ )
+#define AFTR_LOG_WARN( ... )  AFTR_LOG_AT( ::Aftr::LogLevel::Warn,  0, __VA_ARGS__ )
+#define AFTR_LOG_ERROR( ... ) AFTR_LOG_AT( ::Aftr::LogLevel::Error, 0, __VA_ARGS__ )
+/// Rate limited per call site: at most one message every intervalMs; skipped messages are counted
+/// and reported with the next one that is emitted.
+#define AFTR_LOG_DEBUG_EVERY( intervalMs, ... ) AFTR_LOG_AT( ::Aftr::LogLevel::Debug, intervalMs, __VA_ARGS__ )
+#define AFTR_LOG_INFO_EVERY( intervalMs, ... )  AFTR_LOG_AT( ::Aftr::LogLevel::Info,  intervalMs, __VA_ARGS__ )
+#define AFTR_LOG_WARN_EVERY( intervalMs, ... )  AFTR_LOG_AT( ::Aftr::LogLevel::Warn,  intervalMs, __VA_ARGS__ )
@@ -0,0 +1,121 @@
+#include "OceanClipmap.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace Aftr;
+
+namespace
+{
+   int64_t floorDiv2( int64_t v ) { return ( v >= 0 ) ? v / 2 : -( ( -v + 1 ) / 2 ); }
+}
+
+OceanClipmap::OceanClipmap( const Config& cfg )
+{
+   if( cfg.gridCells < 8 || ( cfg.gridCells & ( cfg.gridCells - 1 ) ) != 0 )
+      throw std::invalid_argument( "OceanClipmap::Config::gridCells must be a power of two >= 8" );
+   this->N = cfg.gridCells;
+   this->baseCell = cfg.baseCellSize;
+   this->levels = 1;
+   while( this->levels < MAX_LEVELS && this->getReach() < cfg.farDistance )
+      ++this->levels;
+   for( int L = 0; L < MAX_LEVELS; ++L )
+      this->placement[L].cellSize = this->baseCell * float( 1 << L );
+   this->update( 0.0, 0.0 );
+}
+
+double OceanClipmap::getReach() const
+{
+   //The coarsest level can sit up to two of its cells off-center after snapping
+   double coarsest = double( this->baseCell ) * double( 1 << ( this->levels - 1 ) );
+   return double( this->N / 2 - 2 ) * coarsest;
+}
+
+bool OceanClipmap::update( double cameraX, double cameraY )
+{
+   //k is the camera's cell in the lattice of 2-cell blocks of the current level. Deriving each
+   //coarser k from the finer one by integer halving keeps every level consistent with its neighbor
+   //no matter how the floating point divisions round.
+   int64_t kx = int64_t( std::floor( cameraX / ( 2.0 * this->baseCell ) ) );
+   int64_t ky = int64_t( std::floor( cameraY / ( 2.0 * this->baseCell ) ) );
+   bool changed = false;
+   for( int L = 0; L < this->levels; ++L )
+   {
+      if( L > 0 )
+      {
+         //An even finer k means the finer level sits on the -X (-Y) side of this ring's hole
+         int trim = ( ( kx & 1 ) == 0 ? 1 : 0 ) | ( ( ky & 1 ) == 0 ? 2 : 0 );
+         kx = floorDiv2( kx );
+         ky = floorDiv2( ky );
+         changed |= ( trim != this->placement[L].trimBits );
+         this->placement[L].trimBits = trim;
+      }
+      int64_t ox = 2 * kx - this->N / 2;
+      int64_t oy = 2 * ky - this->N / 2;
+      changed |= ( ox != this->placement[L].originCellX || oy != this->placement[L].originCellY );
+      this->placement[L].originCellX = ox;
+      this->placement[L].originCellY = oy;
+   }
+   return changed;
+}
+
+void OceanClipmap::addPatch( std::vector< GridVertex >& verts, std::vector< uint32_t >& indices,
+                             int level, VertexKind kind, int x0, int y0, int w, int h ) const
+{
+   uint32_t base = uint32_t( verts.size() );
+   for( int y = 0; y <= h; ++y )
+      for( int x = 0; x <= w; ++x )
+         verts.push_back( GridVertex{ float( x0 + x ), float( y0 + y ), float( level ), float( int( kind ) ) } );
+   uint32_t stride = uint32_t( w + 1 );
+   for( int y = 0; y < h; ++y )
+   {
+      for( int x = 0; x < w; ++x )
+      {
+         uint32_t i00 = base + uint32_t( y ) * stride + uint32_t( x );
+         uint32_t i10 = i00 + 1;
+         uint32_t i01 = i00 + stride;
+         uint32_t i11 = i01 + 1;
+         indices.insert( indices.end(), { i00, i10, i11, i00, i11, i01 } ); //counter-clockwise seen from +Z
+      }
+   }
+}
+
+void OceanClipmap::buildMesh( std::vector< GridVertex >& outVerts, std::vector< uint32_t >& outIndices ) const
+{
+   outVerts.clear();
+   outIndices.clear();
+   const int q = this->N / 4;        //hole starts here
+   const int hole = this->N / 2 + 1; //the finer level (N/2 of these cells) plus the one-cell trim
+   const int far = q + hole;         //first cell past the hole
+   this->addPatch( outVerts, outIndices, 0, VertexKind::Grid, 0, 0, this->N, this->N );
+   for( int L = 1; L < this->levels; ++L )
+   {
+      this->addPatch( outVerts, outIndices, L, VertexKind::Grid, 0, 0, this->N, q );               //bottom
+      this->addPatch( outVerts, outIndices, L, VertexKind::Grid, 0, far, this->N, this->N - far ); //top
+      this->addPatch( outVerts, outIndices, L, VertexKind::Grid, 0, q, q, hole );                  //left
+      this->addPatch( outVerts, outIndices, L, VertexKind::Grid, far, q, this->N - far, hole );    //right
+      this->addPatch( outVerts, outIndices, L, VertexKind::TrimColumn, q, q, 1, this->N / 2 );
+      this->addPatch( outVerts, outIndices, L, VertexKind::TrimRow, q, q, hole, 1 );
+   }
+}
+
+void OceanClipmap::worldPosition( const GridVertex& v, double& outX, double& outY ) const
+{
+   const LevelPlacement& p = this->placement[int( v.level )];
+   int64_t gx = int64_t( v.ix );
+   int64_t gy = int64_t( v.iy );
+   switch( VertexKind( int( v.kind ) ) )
+   {
+      case VertexKind::TrimColumn:
+         gx += ( p.trimBits & 1 ) ? this->N / 2 : 0;
+         gy += ( p.trimBits & 2 ) ? 0 : 1;
+         break;
+      case VertexKind::TrimRow:
+         gy += ( p.trimBits & 2 ) ? this->N / 2 : 0;
+         break;
+      default:
+         break;
+   }
+   outX = double( p.originCellX + gx ) * p.cellSize;
+   outY = double( p.originCellY + gy ) * p.cellSize;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace Aftr
+{
+
+/**
+   \class OceanClipmap
+   \brief Placement and mesh layout for the camera-following "infinite ocean".
+
+   The ocean is one fixed mesh made of nested levels. Level 0 is a full gridCells x gridCells grid
+   of baseCellSize cells; level L > 0 is a ring with cells 2^L times larger, covering twice the
+   extent of level L-1, until the rings reach farDistance. Each level is snapped to a lattice of two
+   of its own cells, so vertices only ever sit on fixed world positions and the waves sampled at
+   them never swim as the camera moves.
+
+   Vertices are stored in grid units of their level (see GridVertex); displacement_circ.vert turns
+   them into world positions using one LevelPlacement per level (uniform OceanLevels[L]). Because
+   a finer level can sit one coarse cell off-center inside the coarser ring's hole, every ring has
+   a one-cell L-shaped "trim" (a column strip and a row strip) that the shader moves to whichever
+   side is uncovered, as given by LevelPlacement::trimBits.
+
+   The shader, not this class, keeps the displacement continuous across levels: odd vertices on a
+   level's outer edge average their neighbors (Gerstner waves and wake alike), and waves shorter
+   than two cells are faded out per level with a cell size that ramps to the coarser level's at
+   the edge.
+
+   \{
+*/
+class OceanClipmap
+{
+public:
+   struct Config
+   {
+      int gridCells = 128;         ///< Cells per side of every level; a power of two >= 8
+      float baseCellSize = 1.0f;   ///< Meters per cell at level 0
+      float farDistance = 1000.0f; ///< Rings are added until the ocean reaches this far from the camera
+   };
+
+   enum class VertexKind : int { Grid = 0, TrimColumn = 1, TrimRow = 2 };
+
+   /// A mesh vertex in grid units: (ix, iy) are cell corners in the level's own lattice before the
+   /// trim shift. Stored as floats so it fits the engine's position/texcoord attributes:
+   /// VertexPosition = (ix, iy, level), VertexTexCoord.x = kind.
+   struct GridVertex
+   {
+      float ix;
+      float iy;
+      float level;
+      float kind;
+   };
+
+   struct LevelPlacement
+   {
+      int64_t originCellX = 0; ///< Min corner in this level's cells; always even (snapped to 2 cells)
+      int64_t originCellY = 0;
+      float cellSize = 1.0f;   ///< Meters per cell
+      int trimBits = 0;        ///< bit0: trim column on the +X side of the hole, bit1: trim row on the +Y side
+      double originX() const { return double( originCellX ) * cellSize; }
+      double originY() const { return double( originCellY ) * cellSize; }
+   };
+
+   static constexpr int MAX_LEVELS = 8;
+
+   explicit OceanClipmap( const Config& cfg );
+
+   /// Snaps every level around the camera. Returns true if any placement changed (the shader
+   /// uniforms then need to be refreshed). Never allocates.
+   bool update( double cameraX, double cameraY );
+
+   int getLevelCount() const { return this->levels; }
+   int getGridCells() const { return this->N; }
+   const LevelPlacement& getPlacement( int level ) const { return this->placement[level]; }
+   /// Half-width of the area the ocean covers around its center, in meters.
+   double getReach() const;
+
+   /// Builds the fixed mesh once; it never changes afterwards.
+   void buildMesh( std::vector< GridVertex >& outVerts, std::vector< uint32_t >& outIndices ) const;
+
+   /// World XY of a mesh vertex under the current placement (the same math as displacement_circ.vert).
+   void worldPosition( const GridVertex& v, double& outX, double& outY ) const;
+
+private:
+   void addPatch( std::vector< GridVertex >& verts, std::vector< uint32_t >& indices,
+                  int level, VertexKind kind, int x0, int y0, int w, int h ) const;
+
+   int N = 128;
+   int levels = 1;
+   float baseCell = 1.0f;
+   LevelPlacement placement[MAX_LEVELS];
+};
+
+/** \} */
+
+} //namespace Aftr
@@ -0,0 +1,346 @@
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace Aftr;
+
+TaskGraph::TaskId TaskGraph::add( const char* name, std::function< void() > fn, Affinity affinity )
+{
+   Task t;
+   t.name = name;
+   t.fn = std::move( fn );
+   t.affinity = affinity;
+   this->tasks.push_back( std::move( t ) );
+   this->dirty = true;
+   return TaskId( this->tasks.size() - 1 );
+}
+
+TaskGraph::TaskId TaskGraph::add( const char* name, std::function< void() > fn, std::initializer_list< TaskId > after, Affinity affinity )
+{
+   TaskId id = this->add( name, std::move( fn ), affinity );
+   for( TaskId before : after )
+      this->precede( before, id );
+   return id;
+}
+
+void TaskGraph::precede( TaskId before, TaskId after )
+{
+   TaskId n = TaskId( this->tasks.size() );
+   if( before < 0 || before >= n || after < 0 || after >= n || before == after )
+      throw std::invalid_argument( "TaskGraph::precede: invalid task ids" );
+   this->tasks[before].successors.push_back( after );
+   ++this->tasks[after].predecessorCount;
+   this->dirty = true;
+}
+
+void TaskGraph::prepare()
+{
+   if( !this->dirty )
+      return;
+   //Kahn's algorithm; always taking the lowest ready id makes the serial order stable
+   const size_t n = this->tasks.size();
+   std::vector< int > missing( n );
+   std::vector< TaskId > ready;
+   this->roots.clear();
+   for( size_t i = 0; i < n; ++i )
+   {
+      missing[i] = this->tasks[i].predecessorCount;
+      if( missing[i] == 0 )
+      {
+         ready.push_back( TaskId( i ) );
+         this->roots.push_back( TaskId( i ) );
+      }
+   }
+   auto later = []( TaskId a, TaskId b ) { return a > b; };
+   std::make_heap( ready.begin(), ready.end(), later );
+   this->serialOrder.clear();
+   while( !ready.empty() )
+   {
+      std::pop_heap( ready.begin(), ready.end(), later );
+      TaskId id = ready.back();
+      ready.pop_back();
+      this->serialOrder.push_back( id );
+      for( TaskId s : this->tasks[id].successors )
+         if( --missing[s] == 0 )
+         {
+            ready.push_back( s );
+            std::push_heap( ready.begin(), ready.end(), later );
+         }
+   }
+   if( this->serialOrder.size() != n )
+   {
+      auto stuck = std::find_if( missing.begin(), missing.end(), []( int m ) { return m > 0; } );
+      throw std::logic_error( std::string( "TaskGraph: dependency cycle through task \"" ) +
+                              this->tasks[stuck - missing.begin()].name + "\"" );
+   }
+   this->pending = std::make_unique< std::atomic< int >[] >( n );
+   this->dirty = false;
+}
+
+const std::vector< TaskGraph::TaskId >& TaskGraph::getSerialOrder()
+{
+   this->prepare();
+   return this->serialOrder;
+}
+
+void TaskGraph::runSerial()
+{
+   for( TaskId id : this->getSerialOrder() )
+      this->tasks[id].fn();
+}
+
+void TaskScheduler::WorkQueue::reset( size_t capacity )
+{
+   std::lock_guard< std::mutex > lk( this->mutex );
+   if( this->ring.size() < capacity )
+      this->ring.resize( capacity );
+   this->head = 0;
+   this->count = 0;
+}
+
+void TaskScheduler::WorkQueue::push( TaskGraph::TaskId id )
+{
+   //Every task is pushed at most once per run and the ring holds the whole graph, so it never fills
+   std::lock_guard< std::mutex > lk( this->mutex );
+   this->ring[( this->head + this->count ) % this->ring.size()] = id;
+   ++this->count;
+}
+
+bool TaskScheduler::WorkQueue::popBack( TaskGraph::TaskId& out )
+{
+   std::lock_guard< std::mutex > lk( this->mutex );
+   if( this->count == 0 )
+      return false;
+   --this->count;
+   out = this->ring[( this->head + this->count ) % this->ring.size()];
+   return true;
+}
+
+bool TaskScheduler::WorkQueue::popFront( TaskGraph::TaskId& out )
+{
+   std::lock_guard< std::mutex > lk( this->mutex );
+   if( this->count == 0 )
+      return false;
+   out = this->ring[this->head];
+   this->head = ( this->head + 1 ) % this->ring.size();
+   --this->count;
+   return true;
+}
+
+TaskScheduler::TaskScheduler( unsigned threads )
+{
+   this->setThreadCount( threads );
+}
+
+TaskScheduler::~TaskScheduler()
+{
+   this->stopWorkers();
+}
+
+void TaskScheduler::stopWorkers()
+{
+   {
+      std::lock_guard< std::mutex > lk( this->poolMutex );
+      this->stopping = true;
+   }
+   this->poolWake.notify_all();
+   for( auto& w : this->workers )
+      w.join();
+   this->workers.clear();
+   this->stopping = false;
+}
+
+void TaskScheduler::setThreadCount( unsigned threads )
+{
+   if( threads == 0 )
+      threads = std::max( 1u, std::thread::hardware_concurrency() );
+   if( threads == this->nThreads && this->workers.size() + 1 == threads )
+      return;
+
+   this->stopWorkers();
+   this->nThreads = threads;
+   this->queues.clear();
+   for( unsigned i = 0; i < threads; ++i )
+      this->queues.push_back( std::make_unique< WorkQueue >() );
+   for( unsigned i = 1; i < threads; ++i )
+      this->workers.emplace_back( &TaskScheduler::workerLoop, this, i, this->generation );
+}
+
+void TaskScheduler::run( TaskGraph& g )
+{
+   g.prepare();
+   if( g.tasks.empty() )
+      return;
+   if( this->nThreads == 1 )
+   {
+      std::exception_ptr error;
+      for( TaskGraph::TaskId id : g.serialOrder )
+      {
+         try
+         {
+            g.tasks[id].fn();
+         }
+         catch( ... )
+         {
+            if( !error )
+               error = std::current_exception();
+         }
+      }
+      if( error )
+         std::rethrow_exception( error );
+      return;
+   }
+
+   const size_t n = g.tasks.size();
+   for( size_t i = 0; i < n; ++i )
+      g.pending[i].store( g.tasks[i].predecessorCount, std::memory_order_relaxed );
+   for( auto& q : this->queues )
+      q->reset( n );
+   this->mainQueue.reset( n );
+   //Spread the roots so every worker has something to start on
+   unsigned next = 0;
+   int anyRoots = 0;
+   for( TaskGraph::TaskId id : g.roots )
+   {
+      if( g.tasks[id].affinity == TaskGraph::Affinity::MainThread )
+         this->mainQueue.push( id );
+      else
+      {
+         this->queues[next++ % this->nThreads]->push( id );
+         ++anyRoots;
+      }
+   }
+   this->queuedAny.store( anyRoots );
+   this->queuedMain.store( int( g.roots.size() ) - anyRoots );
+   this->graph = &g;
+   this->firstError = nullptr;
+   this->remaining.store( n, std::memory_order_release );
+
+   {
+      std::lock_guard< std::mutex > lk( this->poolMutex );
+      this->busyWorkers = this->nThreads - 1;
+      ++this->generation;
+   }
+   this->poolWake.notify_all();
+
+   while( this->remaining.load( std::memory_order_acquire ) > 0 )
+   {
+      if( this->runOne( 0 ) )
+         continue;
+      std::unique_lock< std::mutex > lk( this->parkMutex );
+      this->mainIdle.store( true );
+      this->mainReady.wait( lk, [this]() { return this->queuedMain.load() > 0 || this->queuedAny.load() > 0 || this->remaining.load() == 0; } );
+      this->mainIdle.store( false );
+   }
+
+   //Workers may still be scanning queues; they must be parked before the graph can change
+   {
+      std::unique_lock< std::mutex > lk( this->poolMutex );
+      this->poolDone.wait( lk, [this]() { return this->busyWorkers == 0; } );
+   }
+   this->graph = nullptr;
+   if( this->firstError )
+      std::rethrow_exception( this->firstError );
+}
+
+void TaskScheduler::workerLoop( unsigned workerIdx, uint64_t seen )
+{
+   for( ;; )
+   {
+      {
+         std::unique_lock< std::mutex > lk( this->poolMutex );
+         this->poolWake.wait( lk, [&]() { return this->stopping || this->generation != seen; } );
+         if( this->stopping )
+            return;
+         seen = this->generation;
+      }
+      while( this->remaining.load( std::memory_order_acquire ) > 0 )
+      {
+         if( this->runOne( workerIdx ) )
+            continue;
+         std::unique_lock< std::mutex > lk( this->parkMutex );
+         this->idleWorkers.fetch_add( 1 );
+         this->workReady.wait( lk, [this]() { return this->queuedAny.load() > 0 || this->remaining.load() == 0; } );
+         this->idleWorkers.fetch_sub( 1 );
+      }
+      {
+         std::lock_guard< std::mutex > lk( this->poolMutex );
+         if( --this->busyWorkers == 0 )
+            this->poolDone.notify_one();
+      }
+   }
+}
+
+bool TaskScheduler::runOne( unsigned self )
+{
+   TaskGraph::TaskId id = -1;
+   if( self == 0 && this->mainQueue.popBack( id ) )
+      this->queuedMain.fetch_sub( 1 );
+   else
+   {
+      bool found = this->queues[self]->popBack( id );
+      for( unsigned k = 1; !found && k < this->nThreads; ++k )
+         found = this->queues[( self + k ) % this->nThreads]->popFront( id );
+      if( !found )
+         return false;
+      this->queuedAny.fetch_sub( 1 );
+   }
+   this->execute( id, self );
+   return true;
+}
+
+void TaskScheduler::execute( TaskGraph::TaskId id, unsigned self )
+{
+   TaskGraph& g = *this->graph;
+   TaskGraph::Task& t = g.tasks[id];
+   try
+   {
+      t.fn();
+   }
+   catch( ... )
+   {
+      std::lock_guard< std::mutex > lk( this->errorMutex );
+      if( !this->firstError )
+         this->firstError = std::current_exception();
+   }
+   for( TaskGraph::TaskId s : t.successors )
+   {
+      //acq_rel chains the writes of every predecessor to whichever thread releases s
+      if( g.pending[s].fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+      {
+         if( g.tasks[s].affinity == TaskGraph::Affinity::MainThread )
+         {
+            this->mainQueue.push( s );
+            this->queuedMain.fetch_add( 1 );
+         }
+         else
+         {
+            this->queues[self]->push( s );
+            this->queuedAny.fetch_add( 1 );
+         }
+         this->notifyReady( g.tasks[s].affinity );
+      }
+   }
+   if( this->remaining.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+   {
+      std::lock_guard< std::mutex > lk( this->parkMutex );
+      this->workReady.notify_all();
+      this->mainReady.notify_one();
+   }
+}
+
+void TaskScheduler::notifyReady( TaskGraph::Affinity affinity )
+{
+   //Any tasks go to a parked worker if there is one, else to the caller, which runs them too
+   if( affinity == TaskGraph::Affinity::Any && this->idleWorkers.load() > 0 )
+   {
+      std::lock_guard< std::mutex > lk( this->parkMutex );
+      this->workReady.notify_one();
+   }
+   else if( this->mainIdle.load() )
+   {
+      std::lock_guard< std::mutex > lk( this->parkMutex );
+      this->mainReady.notify_one();
+   }
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Aftr
+{
+
+/**
+   \class TaskGraph
+   \brief A fixed set of tasks and the order constraints between them, built once and run every
+   frame by a TaskScheduler.
+
+   A task is a name, a callable, and an affinity: Affinity::MainThread tasks (anything touching
+   OpenGL, GLSLUniforms, or engine state the renderer reads unsynchronized) only ever run on the
+   thread that calls TaskScheduler::run(); Affinity::Any tasks run wherever a worker is free.
+   precede( a, b ) makes b wait until a has finished, so everything a wrote is visible to b.
+   Tasks with no path between them may run concurrently and must not share mutable state.
+
+   Adding tasks or edges allocates; running a graph that did not change does not.
+
+   \{
+*/
+class TaskGraph
+{
+public:
+   using TaskId = int;
+   enum class Affinity : int { Any = 0, MainThread = 1 };
+
+   TaskId add( const char* name, std::function< void() > fn, Affinity affinity = Affinity::Any );
+   /// Adds a task that waits for every task in after.
+   TaskId add( const char* name, std::function< void() > fn, std::initializer_list< TaskId > after, Affinity affinity = Affinity::Any );
+   /// after does not start until before has finished. Throws std::invalid_argument for bad or equal ids.
+   void precede( TaskId before, TaskId after );
+
+   size_t size() const { return this->tasks.size(); }
+   const char* getName( TaskId id ) const { return this->tasks[id].name; }
+   Affinity getAffinity( TaskId id ) const { return this->tasks[id].affinity; }
+
+   /// Every task in dependency order, ties broken by insertion order. Throws std::logic_error if
+   /// the edges form a cycle.
+   const std::vector< TaskId >& getSerialOrder();
+   /// Runs every task on the calling thread in getSerialOrder(). Same results as any parallel run.
+   void runSerial();
+
+private:
+   friend class TaskScheduler;
+
+   struct Task
+   {
+      const char* name = "";
+      std::function< void() > fn;
+      Affinity affinity = Affinity::Any;
+      std::vector< TaskId > successors;
+      int predecessorCount = 0;
+   };
+
+   void prepare(); ///< Validates the graph and sizes the run state after a change
+
+   std::vector< Task > tasks;
+   std::vector< TaskId > serialOrder;
+   std::vector< TaskId > roots;
+   std::unique_ptr< std::atomic< int >[] > pending; ///< Unfinished predecessors per task during a run
+   bool dirty = true;
+};
+
+/** \} */
+
+/**
+   \class TaskScheduler
+   \brief Runs TaskGraphs on a set of persistent work-stealing worker threads plus the caller.
+
+   Each thread owns a queue; a thread that finishes a task pushes the successors it made ready onto
+   its own queue and takes from its back (the data is still in its cache), while idle threads steal
+   from the front of the others. MainThread tasks go to a separate queue that only the caller of
+   run() drains. With one thread the graph runs serially in TaskGraph::getSerialOrder().
+
+   Workers sleep between runs. During a run, a thread that finds nothing to take parks on a
+   condition variable until a task it may run is pushed or the run ends; the caller parks
+   separately so MainThread tasks wake it and not a worker. If a task throws, the remaining tasks
+   still run and run() rethrows the first exception afterwards.
+
+   \{
+*/
+class TaskScheduler
+{
+public:
+   /// threads includes the caller; 0 = hardware concurrency.
+   explicit TaskScheduler( unsigned threads = 0 );
+   ~TaskScheduler();
+   TaskScheduler( const TaskScheduler& ) = delete;
+   TaskScheduler& operator=( const TaskScheduler& ) = delete;
+
+   /// Runs every task of graph once and returns when all have finished. Not reentrant.
+   void run( TaskGraph& graph );
+
+   void setThreadCount( unsigned threads );
+   unsigned getThreadCount() const { return this->nThreads; }
+
+private:
+   //Fixed-capacity ring of task ids; the owner pushes and pops at the back, thieves take the front
+   struct WorkQueue
+   {
+      std::mutex mutex;
+      std::vector< TaskGraph::TaskId > ring;
+      size_t head = 0;
+      size_t count = 0;
+
+      void reset( size_t capacity );
+      void push( TaskGraph::TaskId id );
+      bool popBack( TaskGraph::TaskId& out );
+      bool popFront( TaskGraph::TaskId& out );
+   };
+
+   bool runOne( unsigned self );
+   void execute( TaskGraph::TaskId id, unsigned self );
+   void notifyReady( TaskGraph::Affinity affinity ); ///< Wakes a parked thread that may run a task just pushed
+   void workerLoop( unsigned workerIdx, uint64_t startGeneration );
+   void stopWorkers();
+
+   unsigned nThreads = 1;
+   std::vector< std::thread > workers;
+   std::vector< std::unique_ptr< WorkQueue > > queues; ///< [0] = caller, [i] = worker i
+   WorkQueue mainQueue;                                ///< MainThread tasks, drained by the caller only
+
+   TaskGraph* graph = nullptr;
+   std::atomic< size_t > remaining{ 0 }; ///< Tasks of the current run not yet finished
+   //Parking during a run. Pushers bump a queued count and then read the idle flags, parkers set
+   //their idle flag and then read the counts (all seq_cst), so a push is never missed.
+   std::mutex parkMutex;
+   std::condition_variable workReady; ///< Parked workers
+   std::condition_variable mainReady; ///< The parked caller of run()
+   std::atomic< int > queuedAny{ 0 };  ///< Any tasks pushed and not yet taken
+   std::atomic< int > queuedMain{ 0 }; ///< MainThread tasks pushed and not yet taken
+   std::atomic< int > idleWorkers{ 0 };
+   std::atomic< bool > mainIdle{ false };
+   std::mutex errorMutex;
+   std::exception_ptr firstError;
+
+   std::mutex poolMutex;
+   std::condition_variable poolWake;
+   std::condition_variable poolDone;
+   uint64_t generation = 0;
+   unsigned busyWorkers = 0;
+   bool stopping = false;
+};
+
+/** \} */
+
+} //namespace Aftr
@@ -1,6 +1,7 @@
 #include "WOWayPointSpherical.h"
 #include "MGLWayPointSpherical.h"
 #include "WayPointParameters.h"
+#include "Log.h"
 using namespace Aftr;
 
 WOWayPointSpherical* WOWayPointSpherical::New( const WayPointParametersBase& params, float radius )
@@ -27,18 +28,16 @@ WOWayPointSpherical::~WOWayPointSpherical()
 
 void WOWayPointSpherical::onTrigger()
 {
-   std::cout << std::endl
-             << "This WOWayPoint is a base class. onTrigger()\n"
-             << "does NOT do anything. Inherit a from WOWayPoint\n"
-             << "and overload virtual void onTrigger() to specify an action!" 
-             << "\n";
+   AFTR_LOG_INFO( "\nThis WOWayPoint is a base class. onTrigger()\n"
+                  "does NOT do anything. Inherit a from WOWayPoint\n"
+                  "and overload virtual void onTrigger() to specify an action!\n" );
 }
 
 bool WOWayPointSpherical::activate(Aftr::WO *activator)
 {
    if (activator == nullptr)
    {
-      std::cout << "NULL activator!\n";
+      AFTR_LOG_WARN( "NULL activator!\n" );
       return false;
    }
    Vector translateAmt = this->getPosition();
@@ -0,0 +1,228 @@
+#include "WakeSim.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+   #include <emmintrin.h>
+   #define AFTR_WAKESIM_SSE2 1
+#endif
+
+using namespace Aftr;
+
+namespace
+{
+   //2D explicit wave equation is stable for (c*dt/dx)^2 <= 0.5; keep a margin
+   constexpr float MAX_K = 0.45f;
+
+   int64_t floorToCell( float world, float cell )
+   {
+      return int64_t( std::floor( world / cell ) );
+   }
+}
+
+WakeSim::WakeSim( const Config& cfg )
+{
+   if( cfg.size < 16 || ( cfg.size & ( cfg.size - 1 ) ) != 0 )
+      throw std::invalid_argument( "WakeSim::Config::size must be a power of two >= 16" );
+   this->N = cfg.size;
+   this->mask = cfg.size - 1;
+   this->cell = cfg.cellSize;
+   this->speed = cfg.waveSpeed;
+   this->damping = cfg.damping;
+   this->sponge = std::clamp( cfg.spongeCells, 1, cfg.size / 4 );
+   this->bufA.assign( size_t( N ) * N, 0.0f );
+   this->bufB.assign( size_t( N ) * N, 0.0f );
+   this->cur = this->bufA.data();
+   this->prev = this->bufB.data();
+   this->spongeRow.assign( N, 1.0f );
+   this->spongeCol.assign( N, 1.0f );
+   this->spongeColScaled.assign( N, 1.0f );
+   this->originCellX = -N / 2;
+   this->originCellY = -N / 2;
+   this->rebuildSponge();
+}
+
+void WakeSim::step( float dt )
+{
+   if( dt <= 0.0f )
+      return;
+   this->beginStep( dt );
+   for( int s = this->getSubstepCount( dt ); s > 0; --s )
+   {
+      this->stepRows( 0, N );
+      this->endSubstep();
+   }
+}
+
+int WakeSim::getSubstepCount( float dt ) const
+{
+   float courant = this->speed * std::max( dt, 0.0f ) / this->cell;
+   return std::max( 1, int( std::ceil( courant / std::sqrt( MAX_K ) ) ) );
+}
+
+void WakeSim::beginStep( float dt )
+{
+   float h = std::max( dt, 0.0f ) / float( this->getSubstepCount( dt ) );
+   float c = this->speed * h / this->cell;
+   float decay = std::exp( -this->damping * h );
+   this->stepK = c * c;
+   for( int j = 0; j < N; ++j )
+      this->spongeColScaled[j] = this->spongeCol[j] * decay;
+}
+
+void WakeSim::stepBand( int band, int bandCount )
+{
+   int r0 = int( int64_t( N ) * band / bandCount );
+   int r1 = int( int64_t( N ) * ( band + 1 ) / bandCount );
+   this->stepRows( r0, r1 );
+}
+
+void WakeSim::endSubstep()
+{
+   std::swap( this->cur, this->prev );
+}
+
+void WakeSim::stepRows( int rowBegin, int rowEnd )
+{
+   const float k = this->stepK;
+   const float* dc = this->spongeColScaled.data();
+   for( int i = rowBegin; i < rowEnd; ++i )
+   {
+      const float* c = this->cur + size_t( i ) * N;
+      const float* up = this->cur + size_t( ( i - 1 ) & mask ) * N;
+      const float* dn = this->cur + size_t( ( i + 1 ) & mask ) * N;
+      float* out = this->prev + size_t( i ) * N; //holds h(t-dt) on entry, h(t+dt) on exit
+      const float dr = this->spongeRow[i];
+
+      auto scalarCell = [&]( int j )
+      {
+         float lap = up[j] + dn[j] + c[( j - 1 ) & mask] + c[( j + 1 ) & mask] - 4.0f * c[j];
+         out[j] = ( 2.0f * c[j] - out[j] + k * lap ) * dr * dc[j];
+      };
+
+      scalarCell( 0 );
+      int j = 1;
+#ifdef AFTR_WAKESIM_SSE2
+      const __m128 vk = _mm_set1_ps( k );
+      const __m128 vdr = _mm_set1_ps( dr );
+      const __m128 two = _mm_set1_ps( 2.0f );
+      const __m128 four = _mm_set1_ps( 4.0f );
+      for( ; j + 4 <= N - 1; j += 4 )
+      {
+         __m128 vc = _mm_loadu_ps( c + j );
+         __m128 lap = _mm_add_ps( _mm_add_ps( _mm_loadu_ps( up + j ), _mm_loadu_ps( dn + j ) ),
+                                  _mm_add_ps( _mm_loadu_ps( c + j - 1 ), _mm_loadu_ps( c + j + 1 ) ) );
+         lap = _mm_sub_ps( lap, _mm_mul_ps( four, vc ) );
+         __m128 next = _mm_add_ps( _mm_sub_ps( _mm_mul_ps( two, vc ), _mm_loadu_ps( out + j ) ), _mm_mul_ps( vk, lap ) );
+         next = _mm_mul_ps( _mm_mul_ps( next, vdr ), _mm_loadu_ps( dc + j ) );
+         _mm_storeu_ps( out + j, next );
+      }
+#endif
+      for( ; j < N; ++j )
+         scalarCell( j );
+   }
+}
+
+void WakeSim::recenter( float worldX, float worldY )
+{
+   int64_t newX = floorToCell( worldX, this->cell ) - N / 2;
+   int64_t newY = floorToCell( worldY, this->cell ) - N / 2;
+   int64_t dx = newX - this->originCellX;
+   int64_t dy = newY - this->originCellY;
+   if( dx == 0 && dy == 0 )
+      return;
+
+   //The columns leaving the window share storage with the ones entering it; flatten them
+   int64_t nx = std::min< int64_t >( std::abs( dx ), N );
+   for( int64_t c = 0; c < nx; ++c )
+      this->clearColumn( int( ( dx > 0 ? this->originCellX + c : newX + c ) & mask ) );
+   int64_t ny = std::min< int64_t >( std::abs( dy ), N );
+   for( int64_t r = 0; r < ny; ++r )
+      this->clearRow( int( ( dy > 0 ? this->originCellY + r : newY + r ) & mask ) );
+
+   this->originCellX = newX;
+   this->originCellY = newY;
+   this->rebuildSponge();
+}
+
+void WakeSim::clearColumn( int storageCol )
+{
+   for( int i = 0; i < N; ++i )
+   {
+      this->bufA[size_t( i ) * N + storageCol] = 0.0f;
+      this->bufB[size_t( i ) * N + storageCol] = 0.0f;
+   }
+}
+
+void WakeSim::clearRow( int storageRow )
+{
+   std::fill_n( this->bufA.begin() + size_t( storageRow ) * N, N, 0.0f );
+   std::fill_n( this->bufB.begin() + size_t( storageRow ) * N, N, 0.0f );
+}
+
+void WakeSim::clear()
+{
+   std::fill( this->bufA.begin(), this->bufA.end(), 0.0f );
+   std::fill( this->bufB.begin(), this->bufB.end(), 0.0f );
+}
+
+void WakeSim::rebuildSponge()
+{
+   //Quadratic ramp from 1 (interior) to 0.85 per substep at the outermost cell
+   auto factor = [this]( int logical )
+   {
+      int d = std::min( logical, N - 1 - logical );
+      if( d >= this->sponge )
+         return 1.0f;
+      float t = float( this->sponge - d ) / float( this->sponge );
+      return 1.0f - 0.15f * t * t;
+   };
+   for( int s = 0; s < N; ++s )
+   {
+      this->spongeCol[s] = factor( int( ( s - this->originCellX ) & mask ) );
+      this->spongeRow[s] = factor( int( ( s - this->originCellY ) & mask ) );
+   }
+}
+
+void WakeSim::disturb( float worldX, float worldY, float radius, float depth )
+{
+   int64_t gx0 = floorToCell( worldX - radius, this->cell );
+   int64_t gx1 = floorToCell( worldX + radius, this->cell );
+   int64_t gy0 = floorToCell( worldY - radius, this->cell );
+   int64_t gy1 = floorToCell( worldY + radius, this->cell );
+   //Stay out of the sponge so disturbances never straddle the torus seam
+   gx0 = std::max( gx0, this->originCellX + this->sponge );
+   gy0 = std::max( gy0, this->originCellY + this->sponge );
+   gx1 = std::min( gx1, this->originCellX + N - 1 - this->sponge );
+   gy1 = std::min( gy1, this->originCellY + N - 1 - this->sponge );
+   float invR2 = 1.0f / ( radius * radius );
+   for( int64_t gy = gy0; gy <= gy1; ++gy )
+   {
+      float y = ( float( gy ) + 0.5f ) * this->cell - worldY;
+      for( int64_t gx = gx0; gx <= gx1; ++gx )
+      {
+         float x = ( float( gx ) + 0.5f ) * this->cell - worldX;
+         float q = 1.0f - ( x * x + y * y ) * invR2;
+         if( q > 0.0f )
+            this->cur[this->idx( gx, gy )] -= depth * q * q;
+      }
+   }
+}
+
+float WakeSim::sampleHeight( float worldX, float worldY ) const
+{
+   //cell centers sit at (g + 0.5) * cell
+   float fx = worldX / this->cell - 0.5f;
+   float fy = worldY / this->cell - 0.5f;
+   int64_t gx = int64_t( std::floor( fx ) );
+   int64_t gy = int64_t( std::floor( fy ) );
+   if( gx < this->originCellX || gy < this->originCellY || gx + 1 >= this->originCellX + N || gy + 1 >= this->originCellY + N )
+      return 0.0f;
+   float tx = fx - float( gx );
+   float ty = fy - float( gy );
+   float h00 = this->cur[this->idx( gx, gy )];
+   float h10 = this->cur[this->idx( gx + 1, gy )];
+   float h01 = this->cur[this->idx( gx, gy + 1 )];
+   float h11 = this->cur[this->idx( gx + 1, gy + 1 )];
+   return ( h00 * ( 1 - tx ) + h10 * tx ) * ( 1 - ty ) + ( h01 * ( 1 - tx ) + h11 * tx ) * ty;
+}
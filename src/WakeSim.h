@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Aftr
+{
+
+/**
+   \class WakeSim
+   \brief Local wave-equation height field that moving objects disturb (wakes, splashes, ripples).
+
+   The simulated window is size x size cells of cellSize meters and follows a point (the camera)
+   via recenter(). Storage is toroidal: global cell (gx,gy) always lives at storage
+   (gx mod size, gy mod size), so moving the window only clears the rows/columns that scrolled
+   in and memory never changes. Because of that mapping the height buffer can be uploaded as-is
+   to a GL_REPEAT texture and sampled at uv = worldXY / extent() (see displacement_circ.vert).
+
+   A sponge layer along the window edges absorbs waves before they reach the seam where the
+   torus wraps. step() runs the 5-point stencil with SSE2 where available on the calling thread.
+   WakeSim owns no threads: a caller that wants the step in parallel (a TaskGraph) splits each
+   substep into row bands itself with beginStep() / stepBand() / endSubstep().
+
+   Heights live in CPU memory only; GLViewdisplacement_grid::uploadWake() copies getHeights()
+   into the WakeMap texture once per frame.
+
+   \{
+*/
+class WakeSim
+{
+public:
+   struct Config
+   {
+      int size = 256;          ///< Cells per side; must be a power of two >= 16
+      float cellSize = 1.0f;   ///< Meters per cell
+      float waveSpeed = 6.0f;  ///< Meters per second
+      float damping = 0.35f;   ///< Exponential amplitude decay rate everywhere, 1/s
+      int spongeCells = 16;    ///< Width of the absorbing edge layer in cells
+   };
+
+   explicit WakeSim( const Config& cfg );
+   WakeSim( const WakeSim& ) = delete;
+   WakeSim& operator=( const WakeSim& ) = delete;
+
+   /// Moves the window so the given world point is in its center cell. Cells that scroll in start flat.
+   void recenter( float worldX, float worldY );
+   /// Pushes the surface down by up to depth meters within radius of the given world point
+   /// (smooth falloff). Call once per frame per disturbing object; a moving object leaves a wake.
+   void disturb( float worldX, float worldY, float radius, float depth );
+   /// Advances the simulation on the calling thread; splits dt into substeps that satisfy the CFL limit.
+   void step( float dt );
+   /// Number of substeps step( dt ) runs.
+   int getSubstepCount( float dt ) const;
+   /// step( dt ) driven from outside, same result for any band count: beginStep( dt ), then for
+   /// each of getSubstepCount( dt ) substeps, stepBand( b, bandCount ) for every b in
+   /// [0, bandCount) -- concurrently if wanted -- followed by endSubstep(). Nothing else may touch
+   /// the simulation in between.
+   void beginStep( float dt );
+   void stepBand( int band, int bandCount );
+   void endSubstep();
+   /// Bilinear height at a world point, 0 outside the window.
+   float sampleHeight( float worldX, float worldY ) const;
+   /// Flattens the whole window.
+   void clear();
+
+   int getSize() const { return this->N; }
+   float getCellSize() const { return this->cell; }
+   float getExtent() const { return float( this->N ) * this->cell; } ///< Window side length in meters
+   float getOriginX() const { return float( this->originCellX ) * this->cell; } ///< World X of the window's min corner
+   float getOriginY() const { return float( this->originCellY ) * this->cell; } ///< World Y of the window's min corner
+   /// Heights in toroidal storage order, row-major, size*size floats. Valid until the next step().
+   const float* getHeights() const { return this->cur; }
+
+private:
+   void stepRows( int rowBegin, int rowEnd );
+   void rebuildSponge();
+   void clearColumn( int storageCol );
+   void clearRow( int storageRow );
+   size_t idx( int64_t gx, int64_t gy ) const { return size_t( ( gy & mask ) * N + ( gx & mask ) ); }
+
+   int N = 0;
+   int mask = 0;
+   float cell = 1.0f;
+   float speed = 0.0f;
+   float damping = 0.0f;
+   int sponge = 0;
+   int64_t originCellX = 0;
+   int64_t originCellY = 0;
+
+   std::vector< float > bufA;
+   std::vector< float > bufB;
+   float* cur = nullptr;  ///< h(t)
+   float* prev = nullptr; ///< h(t-dt), overwritten with h(t+dt) by each substep
+   std::vector< float > spongeRow; ///< Per storage row damping factor (1 = none)
+   std::vector< float > spongeCol; ///< Per storage column damping factor, multiplied by decay
+   std::vector< float > spongeColScaled;
+   float stepK = 0.0f; ///< (c*dt/dx)^2 for the substep being run
+};
+
+/** \} */
+
+} //namespace Aftr
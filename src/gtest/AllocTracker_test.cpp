@@ -0,0 +1,168 @@
+#include "gtest/gtest.h"
+#include "AllocTracker.h"
+#include "AftrImGui_displacement_grid.h"
+#ifdef AFTR_CONFIG_USE_IMGUI
+   #include "AftrImGui_MenuBar.h"
+   #include "AftrImGuiIncludes.h"
+#endif
+#include "Mat4.h"
+#include "Vector.h"
+#include <array>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   AllocTracker::ScopeStats findScope( const char* name )
+   {
+      std::array< AllocTracker::ScopeStats, AllocTracker::MAX_SCOPES > scopes;
+      size_t n = AllocTracker::getScopes( scopes.data(), scopes.size() );
+      for( size_t i = 0; i < n; ++i )
+         if( std::string_view( scopes[i].name ) == name )
+            return scopes[i];
+      return {};
+   }
+
+   TEST( AllocTracker, counts_new_and_delete )
+   {
+      if( !AllocTracker::isEnabled() )
+         GTEST_SKIP() << "Configure with -DDISPLACEMENT_GRID_TRACK_ALLOCS=ON to run";
+
+      //Snapshot before any EXPECT_*, gtest's failure messages allocate too. The volatile pointer
+      //keeps the compiler from eliding the new/delete pair.
+      size_t liveBefore = AllocTracker::liveBytes();
+      AllocTracker::Counter c;
+      int* volatile p = new int[100];
+      AllocTracker::Stats afterNew = c.get();
+      size_t liveAfterNew = AllocTracker::liveBytes();
+      delete[] p;
+      AllocTracker::Stats afterDelete = c.get();
+
+      EXPECT_EQ( afterNew.count, 1u );
+      EXPECT_EQ( afterNew.bytes, sizeof( int ) * 100 );
+      EXPECT_GE( liveAfterNew, liveBefore + sizeof( int ) * 100 );
+      EXPECT_EQ( afterDelete.frees, 1u );
+   }
+
+   TEST( AllocTracker, frame_scope_and_peak )
+   {
+      if( !AllocTracker::isEnabled() )
+         GTEST_SKIP() << "Configure with -DDISPLACEMENT_GRID_TRACK_ALLOCS=ON to run";
+
+      AllocTracker::reset();
+      AllocTracker::newFrame();
+      {
+         AFTR_ALLOC_SCOPE( "test.scope" );
+         auto big = std::make_unique< char[] >( 1 << 20 );
+         std::vector< int > v( 16 );
+      }
+      AllocTracker::newFrame();
+
+      EXPECT_GE( AllocTracker::lastFrame().count, 2u );
+      EXPECT_GE( AllocTracker::peakBytesLastFrame(), size_t( 1 << 20 ) );
+
+      AllocTracker::ScopeStats scope = findScope( "test.scope" );
+      ASSERT_STREQ( scope.name, "test.scope" );
+      EXPECT_EQ( scope.lastFrame.count, 2u );
+      EXPECT_EQ( scope.lastFrame.bytes, ( 1u << 20 ) + 16 * sizeof( int ) );
+      //Both blocks were alive together, and both were freed before the scope closed
+      EXPECT_EQ( scope.peakBytesLastFrame, ( 1u << 20 ) + 16 * sizeof( int ) );
+      EXPECT_EQ( scope.peakBytes, ( 1u << 20 ) + 16 * sizeof( int ) );
+      EXPECT_EQ( scope.liveBytes, 0u );
+
+      AllocTracker::SiteStats sites[4];
+      size_t nSites = AllocTracker::getTopSites( sites, 4 );
+      ASSERT_GE( nSites, 1u );
+      for( size_t i = 1; i < nSites; ++i )
+         EXPECT_GE( sites[i - 1].count, sites[i].count );
+   }
+
+   //The Reset button runs inside the "gui.menu" scope: the open scope keeps its slot, another scope
+   //cannot take it over, and frees of blocks allocated before the reset are still charged to it
+   TEST( AllocTracker, reset_inside_open_scope_keeps_attribution )
+   {
+      if( !AllocTracker::isEnabled() )
+         GTEST_SKIP() << "Configure with -DDISPLACEMENT_GRID_TRACK_ALLOCS=ON to run";
+
+      std::unique_ptr< char[] > after;
+      {
+         AFTR_ALLOC_SCOPE( "test.outer" );
+         auto before = std::make_unique< char[] >( 4096 );
+         AllocTracker::reset();
+         {
+            AFTR_ALLOC_SCOPE( "test.other" );
+            std::vector< int > v( 8 );
+         }
+         after = std::make_unique< char[] >( 1024 );
+      }
+      AllocTracker::newFrame();
+
+      AllocTracker::ScopeStats outer = findScope( "test.outer" );
+      ASSERT_STREQ( outer.name, "test.outer" );
+      EXPECT_EQ( outer.total.count, 1u );
+      EXPECT_EQ( outer.total.bytes, 1024u );
+      EXPECT_EQ( outer.liveBytes, 1024u );
+      EXPECT_EQ( outer.peakBytes, 4096u + 1024u );
+
+      AllocTracker::ScopeStats other = findScope( "test.other" );
+      ASSERT_STREQ( other.name, "test.other" );
+      EXPECT_EQ( other.total.count, 1u );
+      EXPECT_EQ( other.total.bytes, 8 * sizeof( int ) );
+      EXPECT_EQ( other.liveBytes, 0u );
+   }
+
+#ifdef AFTR_CONFIG_USE_IMGUI
+   TEST( AllocTracker, compute_pose_hot_path_does_not_allocate )
+   {
+      if( !AllocTracker::isEnabled() )
+         GTEST_SKIP() << "Configure with -DDISPLACEMENT_GRID_TRACK_ALLOCS=ON to run";
+
+      //The moon's orbit, evaluated every frame by GLViewdisplacement_grid
+      AftrImGui_displacement_grid orbit;
+      Mat4 origin;
+      origin.setPosition( Vector( 0, 0, 10 ) );
+      Mat4 pose;
+      orbit.compute_pose( origin ); //first call outside the measurement, as in steady state
+      EXPECT_NO_HEAP_ALLOCS( "compute_pose",
+         for( int i = 0; i < 1000; ++i )
+            pose = orbit.compute_pose( origin ) );
+      EXPECT_NEAR( pose.getZ().z, 1.0f, 1e-4f );
+      EXPECT_NEAR( ( pose.getPosition() - origin.getPosition() ).magnitude(), 100.0f, 1e-2f );
+   }
+
+   //The "gui.menu" scope of GLViewdisplacement_grid: the entries are attached once, and drawing
+   //the bar every frame after that must not touch the heap
+   TEST( AllocTracker, gui_menu_draw_does_not_allocate )
+   {
+      if( !AllocTracker::isEnabled() )
+         GTEST_SKIP() << "Configure with -DDISPLACEMENT_GRID_TRACK_ALLOCS=ON to run";
+
+      ImGuiContext* ctx = ImGui::CreateContext();
+      ImGuiIO& io = ImGui::GetIO();
+      io.DisplaySize = ImVec2( 1280.0f, 720.0f );
+      unsigned char* pixels = nullptr;
+      int w = 0, h = 0;
+      io.Fonts->GetTexDataAsRGBA32( &pixels, &w, &h ); //NewFrame() requires a built font atlas
+
+      AftrImGui_MenuBar menu;
+      bool shown = false;
+      menu.attach( "Profiling", "Show Heap Allocations", [&shown]() { shown = true; } );
+      for( int i = 0; i < 2; ++i ) //the first frames create the bar's window and its storage
+      {
+         ImGui::NewFrame();
+         menu.draw();
+         ImGui::EndFrame();
+      }
+      for( int i = 0; i < 100; ++i )
+      {
+         ImGui::NewFrame();
+         EXPECT_NO_HEAP_ALLOCS( "gui.menu", menu.draw() );
+         ImGui::EndFrame();
+      }
+      EXPECT_FALSE( shown ); //entries start hidden
+      ImGui::DestroyContext( ctx );
+   }
+#endif
+}
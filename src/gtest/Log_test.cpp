@@ -0,0 +1,157 @@
+#include "gtest/gtest.h"
+#include "fmt/core.h"
+#include "fmt/ostream.h" //must include this header to fmt::print( fout ... is found by compiler!
+#include "Log.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   //Collects everything the writer thread emits so tests can inspect it
+   struct CapturedLog
+   {
+      std::mutex m;
+      std::vector< std::string > lines;
+
+      CapturedLog()
+      {
+         Log::setSink( [this]( LogLevel, std::string_view msg ) { std::lock_guard lk( m ); lines.emplace_back( msg ); } );
+      }
+      ~CapturedLog()
+      {
+         Log::flush();
+         Log::setSink( nullptr );
+      }
+      std::vector< std::string > take()
+      {
+         Log::flush();
+         std::lock_guard lk( m );
+         return std::move( lines );
+      }
+   };
+
+   TEST( Log, formats_in_order_on_writer_thread )
+   {
+      CapturedLog cap;
+      std::string owned = "heap string";
+      for( int i = 0; i < 100; ++i )
+         AFTR_LOG_INFO( "msg {} {:.1f} {}\n", i, i * 0.5f, owned );
+      auto lines = cap.take();
+      ASSERT_EQ( lines.size(), 100u );
+      for( int i = 0; i < 100; ++i )
+         EXPECT_EQ( lines[i], fmt::format( "msg {} {:.1f} heap string\n", i, i * 0.5f ) );
+   }
+
+   TEST( Log, level_prefix_and_compile_time_filter )
+   {
+      CapturedLog cap;
+      AFTR_LOG_ERROR( "bad {}\n", 1 );
+      AFTR_LOG_TRACE( "never {}\n", 2 ); //compiled out at the default level (Info)
+      auto lines = cap.take();
+      ASSERT_EQ( lines.size(), Log::enabled( LogLevel::Trace ) ? 2u : 1u );
+      EXPECT_EQ( lines[0], "ERROR: bad 1\n" );
+   }
+
+   TEST( Log, rate_limited_site_reports_suppressed )
+   {
+      CapturedLog cap;
+      for( int pass = 0; pass < 2; ++pass )
+      {
+         for( int i = 0; i < 1000; ++i )
+            AFTR_LOG_INFO_EVERY( 200, "drag {}\n", pass * 1000 + i );
+         std::this_thread::sleep_for( std::chrono::milliseconds( 250 ) ); //let the window expire
+      }
+      auto lines = cap.take();
+      ASSERT_EQ( lines.size(), 2u );
+      EXPECT_EQ( lines[0].substr( 0, 7 ), "drag 0\n" ); //carries the previous run's count under --gtest_repeat
+      EXPECT_EQ( lines[1], "drag 1000\n   (+999 similar suppressed)\n" );
+   }
+
+   //A thread's ring is handed back when it exits, so far more short-lived threads than
+   //MAX_LOGGING_THREADS can log over the life of the process
+   TEST( Log, exited_threads_rings_are_reused )
+   {
+      CapturedLog cap;
+      uint64_t droppedBefore = Log::droppedCount();
+      constexpr int nThreads = 500;
+      for( int t = 0; t < nThreads; ++t )
+      {
+         std::thread th( [t]() { AFTR_LOG_INFO( "thread {}\n", t ); } );
+         th.join();
+      }
+      auto lines = cap.take();
+      EXPECT_EQ( Log::droppedCount(), droppedBefore );
+      ASSERT_EQ( lines.size(), size_t( nThreads ) );
+      for( int t = 0; t < nThreads; ++t )
+         EXPECT_EQ( lines[t], fmt::format( "thread {}\n", t ) );
+   }
+
+   TEST( Log, many_threads_lose_nothing_below_capacity )
+   {
+      CapturedLog cap;
+      uint64_t droppedBefore = Log::droppedCount();
+      constexpr int nThreads = 4;
+      constexpr int perThread = int( Log::LOG_RING_CAPACITY ) / 2;
+      std::vector< std::thread > threads;
+      for( int t = 0; t < nThreads; ++t )
+         threads.emplace_back( [t]() { for( int i = 0; i < perThread; ++i ) AFTR_LOG_WARN( "t{} i{}\n", t, i ); } );
+      for( auto& th : threads )
+         th.join();
+      auto lines = cap.take();
+      if( Log::droppedCount() == droppedBefore )
+         EXPECT_EQ( lines.size(), size_t( nThreads * perThread ) );
+      else //a slow writer may legitimately drop; the drop must then be reported
+         EXPECT_TRUE( std::any_of( lines.begin(), lines.end(), []( const std::string& s ) { return s.find( "dropped" ) != std::string::npos; } ) );
+   }
+
+   //Benchmark: nanoseconds spent at the call site (enqueue only; formatting and I/O happen on the
+   //writer thread). Results are written next to the test binary.
+   TEST( Log, call_site_cost_benchmark )
+   {
+      std::ofstream fout;
+      fout.open( "./Log_call_site_benchmark.txt" );
+      if( !fout )
+         EXPECT_TRUE( false ); //fail if cannot write to file
+
+      Log::setSink( []( LogLevel, std::string_view ) {} ); //measure the logger, not the terminal
+      using clk = std::chrono::steady_clock;
+      constexpr int N = int( Log::LOG_RING_CAPACITY ) / 2; //stay below capacity so nothing is dropped
+      constexpr int reps = 200;
+      auto bench = [&]( const char* label, auto&& body )
+      {
+         double best = 1e30;
+         for( int r = 0; r < reps; ++r )
+         {
+            Log::flush();
+            auto t0 = clk::now();
+            for( int i = 0; i < N; ++i )
+               body( i );
+            auto t1 = clk::now();
+            best = std::min( best, std::chrono::duration< double, std::nano >( t1 - t0 ).count() / N );
+         }
+         fmt::print( fout, "{:<40s} {:8.1f} ns/call\n", label, best );
+         fmt::print( "{:<40s} {:8.1f} ns/call\n", label, best );
+         return best;
+      };
+
+      float f = 1.5f;
+      bench( "AFTR_LOG_INFO (int, float)", [&]( int i ) { AFTR_LOG_INFO( "value {} {:f}\n", i, f ); } );
+      bench( "AFTR_LOG_INFO (no args)", [&]( int ) { AFTR_LOG_INFO( "constant message\n" ); } );
+      bench( "AFTR_LOG_INFO_EVERY (suppressed)", [&]( int i ) { AFTR_LOG_INFO_EVERY( 60000, "value {}\n", i ); } );
+      double off = bench( "AFTR_LOG_TRACE (compiled out)", [&]( int i ) { AFTR_LOG_TRACE( "value {}\n", i ); } );
+      bench( "fmt::format (synchronous baseline)", [&]( int i ) { std::string s = fmt::format( "value {} {:f}\n", i, f ); (void)s; } );
+      if( !Log::enabled( LogLevel::Trace ) )
+      {
+         EXPECT_LT( off, 20.0 );
+      }
+
+      Log::flush();
+      Log::setSink( nullptr );
+   }
+}
@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+#include "OceanClipmap.h"
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   struct WorldMesh
+   {
+      std::vector< double > x, y;
+      std::vector< uint32_t > idx;
+   };
+
+   WorldMesh toWorld( const OceanClipmap& c, const std::vector< OceanClipmap::GridVertex >& verts, const std::vector< uint32_t >& idx )
+   {
+      WorldMesh m;
+      m.x.resize( verts.size() );
+      m.y.resize( verts.size() );
+      for( size_t i = 0; i < verts.size(); ++i )
+         c.worldPosition( verts[i], m.x[i], m.y[i] );
+      m.idx = idx;
+      return m;
+   }
+
+   //Number of (non-degenerate) triangles containing the point
+   int coverage( const WorldMesh& m, double px, double py )
+   {
+      int n = 0;
+      for( size_t t = 0; t + 2 < m.idx.size(); t += 3 )
+      {
+         double ax = m.x[m.idx[t]], ay = m.y[m.idx[t]];
+         double bx = m.x[m.idx[t + 1]], by = m.y[m.idx[t + 1]];
+         double cx = m.x[m.idx[t + 2]], cy = m.y[m.idx[t + 2]];
+         double d1 = ( bx - ax ) * ( py - ay ) - ( by - ay ) * ( px - ax );
+         double d2 = ( cx - bx ) * ( py - by ) - ( cy - by ) * ( px - bx );
+         double d3 = ( ax - cx ) * ( py - cy ) - ( ay - cy ) * ( px - cx );
+         if( d1 > 0 && d2 > 0 && d3 > 0 )
+            ++n;
+      }
+      return n;
+   }
+
+   TEST( OceanClipmap, rings_reach_the_far_clip_plane )
+   {
+      OceanClipmap c( OceanClipmap::Config{ 128, 1.0f, 1000.0f } );
+      EXPECT_EQ( c.getLevelCount(), 6 ); //(64 - 2) * 16 m = 992 m falls just short with 5
+      EXPECT_GE( c.getReach(), 1000.0 );
+      for( int L = 0; L < c.getLevelCount(); ++L )
+         EXPECT_FLOAT_EQ( c.getPlacement( L ).cellSize, float( 1 << L ) );
+   }
+
+   TEST( OceanClipmap, snapping_keeps_vertices_on_a_fixed_lattice )
+   {
+      OceanClipmap c( OceanClipmap::Config{ 64, 0.5f, 300.0f } );
+      std::vector< OceanClipmap::GridVertex > verts;
+      std::vector< uint32_t > idx;
+      c.buildMesh( verts, idx );
+
+      //Small moves inside one 2-cell block do not move anything
+      c.update( 0.1, 0.1 );
+      EXPECT_FALSE( c.update( 0.9, 0.2 ) );
+      EXPECT_TRUE( c.update( 1.1, 0.2 ) );
+
+      std::mt19937 rng( 7 );
+      std::uniform_real_distribution< double > d( -5.0e4, 5.0e4 );
+      for( int i = 0; i < 50; ++i )
+      {
+         double cx = d( rng ), cy = d( rng );
+         c.update( cx, cy );
+         for( int L = 0; L < c.getLevelCount(); ++L )
+         {
+            const auto& p = c.getPlacement( L );
+            EXPECT_EQ( p.originCellX % 2, 0 );
+            EXPECT_EQ( p.originCellY % 2, 0 );
+            //the camera stays within two cells of each level's center
+            double half = c.getGridCells() / 2 * double( p.cellSize );
+            EXPECT_LE( std::abs( p.originX() + half - cx ), 2.0 * p.cellSize );
+            EXPECT_LE( std::abs( p.originY() + half - cy ), 2.0 * p.cellSize );
+         }
+         for( size_t v = 0; v < verts.size(); v += 97 )
+         {
+            double wx, wy;
+            c.worldPosition( verts[v], wx, wy );
+            double cell = c.getPlacement( int( verts[v].level ) ).cellSize;
+            EXPECT_DOUBLE_EQ( wx / cell, std::round( wx / cell ) );
+            EXPECT_DOUBLE_EQ( wy / cell, std::round( wy / cell ) );
+         }
+      }
+   }
+
+   TEST( OceanClipmap, levels_tile_without_gaps_or_overlaps )
+   {
+      OceanClipmap c( OceanClipmap::Config{ 16, 1.0f, 40.0f } );
+      std::vector< OceanClipmap::GridVertex > verts;
+      std::vector< uint32_t > idx;
+      c.buildMesh( verts, idx );
+      std::mt19937 rng( 11 );
+      //Cover all four trim configurations on every level
+      for( double cam : { 0.3, 2.7, 5.1, 7.9, -3.3, -6.6 } )
+      {
+         c.update( cam, -cam * 0.7 );
+         WorldMesh m = toWorld( c, verts, idx );
+         double reach = c.getReach() - 1.0;
+         std::uniform_real_distribution< double > d( -reach, reach );
+         for( int i = 0; i < 400; ++i )
+         {
+            //offsets of 1/3 and 1/7 keep samples off cell edges and diagonals
+            double px = std::floor( cam + d( rng ) ) + 1.0 / 3.0;
+            double py = std::floor( -cam * 0.7 + d( rng ) ) + 1.0 / 7.0;
+            EXPECT_EQ( coverage( m, px, py ), 1 ) << "camera " << cam << " point " << px << "," << py;
+         }
+      }
+   }
+
+   TEST( OceanClipmap, mesh_is_fixed_size_wherever_the_camera_goes )
+   {
+      OceanClipmap c( OceanClipmap::Config{} );
+      std::vector< OceanClipmap::GridVertex > verts;
+      std::vector< uint32_t > idx;
+      c.buildMesh( verts, idx );
+      size_t nv = verts.size(), ni = idx.size();
+      c.update( 1.0e6, -2.5e6 );
+      std::vector< OceanClipmap::GridVertex > verts2;
+      std::vector< uint32_t > idx2;
+      c.buildMesh( verts2, idx2 );
+      EXPECT_EQ( verts2.size(), nv );
+      EXPECT_EQ( idx2.size(), ni );
+      EXPECT_LT( nv, size_t( 1 ) << 17 );
+   }
+}
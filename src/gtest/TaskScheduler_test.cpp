@@ -0,0 +1,299 @@
+#include "gtest/gtest.h"
+#include "fmt/core.h"
+#include "fmt/ostream.h" //must include this header to fmt::print( fout ... is found by compiler!
+#include "TaskScheduler.h"
+#include "TestThreadCounts.h"
+#include "WakeSim.h"
+#include "OceanClipmap.h"
+#ifdef AFTR_CONFIG_USE_IMGUI
+   #include "AftrImGui_displacement_grid.h"
+   #include "Mat4.h"
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   //Deterministic CPU work whose result depends on its input, so reordering would show up
+   uint64_t mix( uint64_t seed, int rounds )
+   {
+      uint64_t h = seed;
+      for( int i = 0; i < rounds; ++i )
+      {
+         h ^= h >> 33;
+         h *= 0xff51afd7ed558ccdULL;
+         h ^= h >> 29;
+      }
+      return h;
+   }
+
+   //Random DAG: task i may depend on any earlier task. Each task hashes its predecessors' outputs,
+   //records its start/finish sequence numbers, and the thread it ran on.
+   struct RandomDag
+   {
+      TaskGraph graph;
+      std::vector< std::vector< int > > preds;
+      std::vector< uint64_t > out;
+      std::vector< int > startSeq, finishSeq;
+      std::vector< std::thread::id > ranOn;
+      std::vector< int > runs;
+      std::atomic< int > seq{ 0 };
+
+      RandomDag( int n, unsigned seed, int work )
+         : preds( n ), out( n ), startSeq( n ), finishSeq( n ), ranOn( n ), runs( n )
+      {
+         std::mt19937 rng( seed );
+         for( int i = 0; i < n; ++i )
+         {
+            auto affinity = ( rng() % 5 == 0 ) ? TaskGraph::Affinity::MainThread : TaskGraph::Affinity::Any;
+            TaskGraph::TaskId id = this->graph.add( "task", [this, i, work]()
+               {
+                  this->startSeq[i] = this->seq.fetch_add( 1 );
+                  uint64_t h = uint64_t( i ) + 1;
+                  for( int p : this->preds[i] )
+                     h = mix( h ^ this->out[p], 1 );
+                  this->out[i] = mix( h, work );
+                  this->ranOn[i] = std::this_thread::get_id();
+                  ++this->runs[i];
+                  this->finishSeq[i] = this->seq.fetch_add( 1 );
+               }, affinity );
+            EXPECT_EQ( id, i );
+            for( int j = 0; j < i; ++j )
+               if( rng() % 8 == 0 )
+               {
+                  this->graph.precede( j, i );
+                  this->preds[i].push_back( j );
+               }
+         }
+      }
+   };
+
+   TEST( TaskScheduler, serial_order_is_topological_and_stable )
+   {
+      TaskGraph g;
+      auto c = g.add( "c", [] {} );
+      auto a = g.add( "a", [] {} );
+      auto b = g.add( "b", [] {}, { a } );
+      g.precede( b, c );
+      auto d = g.add( "d", [] {} );
+      std::vector< TaskGraph::TaskId > expected{ a, b, c, d };
+      EXPECT_EQ( g.getSerialOrder(), expected );
+   }
+
+   TEST( TaskScheduler, rejects_bad_edges_and_cycles )
+   {
+      TaskGraph g;
+      auto a = g.add( "a", [] {} );
+      auto b = g.add( "b", [] {}, { a } );
+      EXPECT_THROW( g.precede( a, a ), std::invalid_argument );
+      EXPECT_THROW( g.precede( a, 7 ), std::invalid_argument );
+      g.precede( b, a );
+      EXPECT_THROW( g.getSerialOrder(), std::logic_error );
+      TaskScheduler s( 2 );
+      EXPECT_THROW( s.run( g ), std::logic_error );
+   }
+
+   //Every task runs exactly once, after all of its predecessors finished, MainThread tasks run on
+   //the caller, and the outputs match the serial run for every thread count
+   TEST( TaskScheduler, dependencies_respected_and_results_deterministic )
+   {
+      RandomDag reference( 200, 42, 50 );
+      reference.graph.runSerial();
+
+      for( unsigned threads : threadCountsToTest() )
+      {
+         TaskScheduler s( threads );
+         RandomDag dag( 200, 42, 50 );
+         for( int frame = 0; frame < 20; ++frame )
+         {
+            std::fill( dag.runs.begin(), dag.runs.end(), 0 );
+            s.run( dag.graph );
+            for( size_t i = 0; i < dag.out.size(); ++i )
+            {
+               ASSERT_EQ( dag.runs[i], 1 );
+               for( int p : dag.preds[i] )
+                  ASSERT_LT( dag.finishSeq[p], dag.startSeq[i] ) << "task " << i << " started before " << p << " finished";
+               if( dag.graph.getAffinity( TaskGraph::TaskId( i ) ) == TaskGraph::Affinity::MainThread )
+               {
+                  ASSERT_EQ( dag.ranOn[i], std::this_thread::get_id() );
+               }
+            }
+            ASSERT_EQ( dag.out, reference.out ) << threads << " threads, frame " << frame;
+         }
+      }
+   }
+
+   //Independent tasks do spread over the workers
+   TEST( TaskScheduler, independent_tasks_use_several_threads )
+   {
+      unsigned hw = std::thread::hardware_concurrency();
+      if( hw < 2 )
+         GTEST_SKIP() << "single core machine";
+      TaskScheduler s( 2 );
+      TaskGraph g;
+      std::atomic< int > inFlight{ 0 };
+      std::atomic< int > maxInFlight{ 0 };
+      for( int i = 0; i < 8; ++i )
+         g.add( "spin", [&]()
+            {
+               int now = ++inFlight;
+               int seen = maxInFlight.load();
+               while( now > seen && !maxInFlight.compare_exchange_weak( seen, now ) ) {}
+               std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+               --inFlight;
+            } );
+      s.run( g );
+      EXPECT_EQ( maxInFlight.load(), 2 );
+   }
+
+   TEST( TaskScheduler, exception_rethrown_after_graph_finishes )
+   {
+      for( unsigned threads : { 1u, 4u } )
+      {
+         TaskScheduler s( threads );
+         TaskGraph g;
+         int after = 0;
+         auto bad = g.add( "bad", []() { throw std::runtime_error( "boom" ); } );
+         g.add( "after", [&]() { ++after; }, { bad }, TaskGraph::Affinity::MainThread );
+         EXPECT_THROW( s.run( g ), std::runtime_error );
+         EXPECT_EQ( after, 1 );
+         //The scheduler stays usable
+         EXPECT_THROW( s.run( g ), std::runtime_error );
+         EXPECT_EQ( after, 2 );
+      }
+   }
+
+   TEST( TaskScheduler, thread_count_can_change_between_runs )
+   {
+      RandomDag reference( 64, 7, 10 );
+      reference.graph.runSerial();
+      RandomDag dag( 64, 7, 10 );
+      TaskScheduler s( 1 );
+      for( unsigned threads : { 3u, 1u, 2u, 0u } )
+      {
+         s.setThreadCount( threads );
+         EXPECT_GE( s.getThreadCount(), 1u );
+         s.run( dag.graph );
+         EXPECT_EQ( dag.out, reference.out );
+      }
+   }
+
+   //Benchmark: GLViewdisplacement_grid::buildFrameGraph() with the engine-free stages run for
+   //real -- the WakeSim step split into row bands, OceanClipmap::update(), and the orbit pose when
+   //ImGui is built -- and the main-thread stages reduced to their CPU side (moving the camera,
+   //copying the wake heights for upload). Timed for 1..N threads; results are written next to
+   //the test binary.
+   TEST( TaskScheduler, frame_update_scaling_benchmark )
+   {
+      std::ofstream fout;
+      fout.open( "./TaskScheduler_scaling_benchmark.txt" );
+      if( !fout )
+         EXPECT_TRUE( false ); //fail if cannot write to file
+
+      constexpr float FRAME_DT = 0.016f;
+      constexpr int FRAMES = 200;
+
+      struct Frame
+      {
+         WakeSim wake;
+         OceanClipmap clipmap;
+         std::vector< float > wakeUpload;
+         float camX = 0.0f, camY = 0.0f, waveTime = 0.0f, moonX = 0.0f, moonY = 0.0f;
+         float levels[OceanClipmap::MAX_LEVELS][4] = {};
+         bool placementChanged = false;
+#ifdef AFTR_CONFIG_USE_IMGUI
+         AftrImGui_displacement_grid orbit;
+#endif
+         Frame( const WakeSim::Config& w, const OceanClipmap::Config& c ) : wake( w ), clipmap( c ), wakeUpload( size_t( w.size ) * w.size ) {}
+      };
+
+      WakeSim::Config wakeCfg;
+      wakeCfg.size = 512;
+      OceanClipmap::Config oceanCfg;
+
+      auto runFrames = [&]( unsigned threads, double& msPerFrame ) -> std::vector< float >
+      {
+         Frame f( wakeCfg, oceanCfg );
+         TaskScheduler s( threads );
+         TaskGraph g;
+         using Affinity = TaskGraph::Affinity;
+         auto base = g.add( "camera", [&]() { f.camX += 0.35f; f.camY += 0.1f; }, Affinity::MainThread );
+         auto waveTime = g.add( "waveTime", [&]() { f.waveTime += FRAME_DT; } );
+         auto moonPose = g.add( "moonPose", [&]()
+            {
+#ifdef AFTR_CONFIG_USE_IMGUI
+               Mat4 plane;
+               plane.setPosition( Vector( f.camX, f.camY, 2.0f ) );
+               Mat4 pose = f.orbit.compute_pose( plane );
+               f.moonX = pose.getPosition().x;
+               f.moonY = pose.getPosition().y;
+#else
+               f.moonX = f.camX + 10.0f;
+               f.moonY = f.camY;
+#endif
+            }, { base } );
+         auto wakeDone = g.add( "wakePrepare", [&]()
+            {
+               f.wake.recenter( f.camX, f.camY );
+               f.wake.disturb( f.camX, f.camY, 6.0f, 0.05f );
+               f.wake.disturb( f.moonX, f.moonY, 3.0f, 0.05f );
+               f.wake.beginStep( FRAME_DT );
+            }, { base, moonPose, waveTime } );
+         int bands = int( 2 * s.getThreadCount() );
+         for( int sub = 0; sub < f.wake.getSubstepCount( FRAME_DT ); ++sub )
+         {
+            auto swap = g.add( "wakeEndSubstep", [&]() { f.wake.endSubstep(); } );
+            for( int b = 0; b < bands; ++b )
+               g.precede( g.add( "wakeBand", [&f, b, bands]() { f.wake.stepBand( b, bands ); }, { wakeDone } ), swap );
+            wakeDone = swap;
+         }
+         g.add( "wakeUpload", [&]() { std::copy_n( f.wake.getHeights(), f.wakeUpload.size(), f.wakeUpload.begin() ); }, { wakeDone }, Affinity::MainThread );
+         auto placement = g.add( "oceanPlacement", [&]() { f.placementChanged = f.clipmap.update( f.camX, f.camY ); }, { base } );
+         g.add( "oceanUpload", [&]()
+            {
+               if( !f.placementChanged )
+                  return;
+               for( int L = 0; L < f.clipmap.getLevelCount(); ++L )
+               {
+                  const auto& p = f.clipmap.getPlacement( L );
+                  float v[4] = { float( p.originX() ), float( p.originY() ), p.cellSize, float( p.trimBits ) };
+                  std::copy_n( v, 4, f.levels[L] );
+               }
+            }, { placement }, Affinity::MainThread );
+
+         s.run( g ); //warm up caches and workers
+         auto t0 = std::chrono::steady_clock::now();
+         for( int frame = 0; frame < FRAMES; ++frame )
+            s.run( g );
+         auto t1 = std::chrono::steady_clock::now();
+         msPerFrame = std::chrono::duration< double, std::milli >( t1 - t0 ).count() / FRAMES;
+         return f.wakeUpload;
+      };
+
+      fmt::print( fout, "{:>8s} {:>12s} {:>10s}\n", "threads", "ms/frame", "speedup" );
+      double serialMs = 0.0;
+      std::vector< float > expected;
+      for( unsigned threads : threadCountsToTest() )
+      {
+         double ms = 0.0;
+         std::vector< float > heights = runFrames( threads, ms );
+         if( threads == 1 )
+         {
+            serialMs = ms;
+            expected = heights;
+         }
+         EXPECT_EQ( heights, expected ); //same frames, same wake at every thread count
+         fmt::print( fout, "{:>8d} {:>12.3f} {:>9.2f}x\n", threads, ms, serialMs / ms );
+         fmt::print( "{:>8d} {:>12.3f} {:>9.2f}x\n", threads, ms, serialMs / ms );
+      }
+   }
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace Aftr
+{
+   /// Thread counts the threading tests and benchmarks run with: 1, 2, 4, 8, and the machine's
+   /// hardware concurrency, ascending.
+   inline std::vector< unsigned > threadCountsToTest()
+   {
+      unsigned hw = std::max( 1u, std::thread::hardware_concurrency() );
+      std::vector< unsigned > counts{ 1, 2, 4, 8 };
+      if( std::find( counts.begin(), counts.end(), hw ) == counts.end() )
+         counts.push_back( hw );
+      std::sort( counts.begin(), counts.end() );
+      return counts;
+   }
+}
@@ -0,0 +1,140 @@
+#include "gtest/gtest.h"
+#include "fmt/core.h"
+#include "fmt/ostream.h" //must include this header to fmt::print( fout ... is found by compiler!
+#include "WakeSim.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   float maxAbs( const WakeSim& w )
+   {
+      const float* h = w.getHeights();
+      size_t n = size_t( w.getSize() ) * w.getSize();
+      float m = 0;
+      for( size_t i = 0; i < n; ++i )
+         m = std::max( m, std::abs( h[i] ) );
+      return m;
+   }
+
+   TEST( WakeSim, ripple_spreads_and_decays )
+   {
+      WakeSim::Config cfg;
+      cfg.size = 128;
+      WakeSim w( cfg );
+      w.disturb( 0, 0, 3.0f, 1.0f );
+      EXPECT_NEAR( w.sampleHeight( 0.0f, 0.0f ), -1.0f, 0.15f );
+      EXPECT_EQ( w.sampleHeight( 20.0f, 0.0f ), 0.0f );
+
+      for( int i = 0; i < 120; ++i ) //2 seconds at 60 Hz: the ring front travels ~12 m
+         w.step( 1.0f / 60.0f );
+      EXPECT_GT( std::abs( w.sampleHeight( 12.0f, 0.0f ) ), 0.01f );
+      EXPECT_LT( std::abs( w.sampleHeight( 40.0f, 0.0f ) ), 1e-3f ); //not reached yet
+
+      for( int i = 0; i < 60 * 30; ++i ) //stays bounded and dies out (damping + sponge)
+         w.step( 1.0f / 60.0f );
+      EXPECT_LT( maxAbs( w ), 0.01f );
+   }
+
+   TEST( WakeSim, large_dt_is_substepped_and_stable )
+   {
+      WakeSim::Config cfg;
+      cfg.size = 64;
+      WakeSim w( cfg );
+      w.disturb( 0, 0, 4.0f, 1.0f );
+      for( int i = 0; i < 50; ++i )
+         w.step( 0.5f );
+      EXPECT_TRUE( std::isfinite( maxAbs( w ) ) );
+      EXPECT_LT( maxAbs( w ), 1.0f );
+   }
+
+   TEST( WakeSim, recenter_scrolls_toroidally )
+   {
+      WakeSim::Config cfg;
+      cfg.size = 64;
+      cfg.cellSize = 0.5f;
+      WakeSim w( cfg );
+      const float* storage = w.getHeights();
+      w.disturb( 2.0f, 2.0f, 1.5f, 1.0f );
+      float before = w.sampleHeight( 2.0f, 2.0f );
+      ASSERT_LT( before, -0.5f );
+
+      //Move by less than half the window: the disturbance is still inside and untouched
+      w.recenter( 6.0f, 3.0f );
+      EXPECT_EQ( w.sampleHeight( 2.0f, 2.0f ), before );
+      EXPECT_FLOAT_EQ( w.getOriginX(), 6.0f - 16.0f );
+      EXPECT_FLOAT_EQ( w.getOriginY(), 3.0f - 16.0f );
+
+      //Move away so it scrolls out, then come back: the cells were recycled and start flat
+      w.recenter( 40.0f, 3.0f );
+      EXPECT_EQ( w.sampleHeight( 2.0f, 2.0f ), 0.0f );
+      w.recenter( 0.0f, 0.0f );
+      EXPECT_EQ( w.sampleHeight( 2.0f, 2.0f ), 0.0f );
+      EXPECT_LT( maxAbs( w ), 1e-6f );
+
+      //Storage never moves or grows
+      EXPECT_EQ( w.getHeights(), storage );
+   }
+
+   //beginStep/stepBand/endSubstep, with bands run in any order, is step() bit for bit
+   TEST( WakeSim, external_bands_match_step )
+   {
+      WakeSim::Config cfg;
+      cfg.size = 64;
+      WakeSim a( cfg );
+      WakeSim b( cfg );
+      const float dt = 0.25f;
+      ASSERT_GT( a.getSubstepCount( dt ), 1 );
+      for( int i = 0; i < 20; ++i )
+      {
+         a.disturb( float( i ), 0.0f, 3.0f, 0.1f );
+         b.disturb( float( i ), 0.0f, 3.0f, 0.1f );
+         a.step( dt );
+         b.beginStep( dt );
+         for( int s = 0; s < b.getSubstepCount( dt ); ++s )
+         {
+            for( int band = 6; band >= 0; --band )
+               b.stepBand( band, 7 );
+            b.endSubstep();
+         }
+      }
+      size_t n = size_t( cfg.size ) * cfg.size;
+      EXPECT_TRUE( std::equal( a.getHeights(), a.getHeights() + n, b.getHeights() ) );
+      EXPECT_GT( maxAbs( a ), 0.0f );
+   }
+
+   //Benchmark: wall time of one 60 Hz step() (single-threaded) for several grid sizes. The banded
+   //step on the frame graph is measured by TaskScheduler.frame_update_scaling_benchmark. Results are
+   //written next to the test binary.
+   TEST( WakeSim, step_time_benchmark )
+   {
+      std::ofstream fout;
+      fout.open( "./WakeSim_step_benchmark.txt" );
+      if( !fout )
+         EXPECT_TRUE( false ); //fail if cannot write to file
+
+      fmt::print( fout, "{:>6s} {:>12s} {:>14s}\n", "size", "ms/step", "Mcells/s" );
+      for( int size : { 256, 512, 1024 } )
+      {
+         WakeSim::Config cfg;
+         cfg.size = size;
+         WakeSim w( cfg );
+         w.disturb( 0, 0, 5.0f, 1.0f );
+         int iters = std::max( 4, ( 1 << 24 ) / ( size * size ) );
+         w.step( 1.0f / 60.0f ); //warm up caches
+         auto t0 = std::chrono::steady_clock::now();
+         for( int i = 0; i < iters; ++i )
+            w.step( 1.0f / 60.0f );
+         auto t1 = std::chrono::steady_clock::now();
+         double ms = std::chrono::duration< double, std::milli >( t1 - t0 ).count() / iters;
+         double mcells = double( size ) * size / ( ms * 1000.0 );
+         fmt::print( fout, "{:>6d} {:>12.3f} {:>14.1f}\n", size, ms, mcells );
+         fmt::print( "{:>6d} {:>12.3f} {:>14.1f}\n", size, ms, mcells );
+         EXPECT_TRUE( std::isfinite( maxAbs( w ) ) );
+      }
+   }
+}
@@ -7,6 +7,7 @@
 #include <vector>
 #include <memory>
 #include "GLViewdisplacement_grid.h" //GLView subclass instantiated to drive this simulation
+#include "Log.h"
 
 /**
    This creates a GLView subclass instance and begins the GLView's main loop.
@@ -27,6 +28,7 @@ int main( int argc, char* argv[] )
    }
    while( simStatus != 0 );
 
+   Aftr::Log::shutdown(); //write any queued log messages before the final line below
    std::cout << "Exited AftrBurner Engine Normally..." << std::endl;
    return 0;
 }